@@ -38,6 +38,10 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
 #include <stdint.h>
 #include <string.h> // CBC mode, for memset
 #include "aes.h"
+#include "aes_bitslice.h"
+#include "aes_ni.h"
+#include "aes_ttable.h"
+#include "cpu.h"
 
 /*****************************************************************************/
 /* Defines:                                                                  */
@@ -222,14 +226,56 @@ static void KeyExpansion(uint8_t* RoundKey, const uint8_t* Key)
   }
 }
 
+static enum AES_backend backend = AES_BACKEND_TTABLE;
+
+static void BindBackend(void)
+{
+  backend = AESNI_supported() ? AES_BACKEND_AESNI : AES_BACKEND_TTABLE;
+}
+
+__attribute__((constructor)) static void SelectBackend(void)
+{
+  TTABLE_init(sbox, rsbox);
+  CPU_register(BindBackend);
+}
+
+enum AES_backend AES_get_backend(void)
+{
+  return backend;
+}
+
+int AES_set_backend(enum AES_backend b)
+{
+  if (b == AES_BACKEND_AESNI && !AESNI_supported())
+  {
+    return 0;
+  }
+  backend = b;
+  return 1;
+}
+
 void AES_init_ctx(struct AES_ctx* ctx, const uint8_t* key)
 {
-  KeyExpansion(ctx->RoundKey, key);
+  // All of the schedules are computed regardless of the backend so that
+  // contexts survive AES_set_backend().
+#if AESNI_AVAILABLE && Nk == 4
+  if (backend == AES_BACKEND_AESNI)
+  {
+    AESNI_expand_key128(key, ctx->RoundKey);
+    AESNI_invert_key(ctx->RoundKey, ctx->InvRoundKey, Nr);
+  }
+  else
+#endif
+  {
+    KeyExpansion(ctx->RoundKey, key);
+    TTABLE_invert_key(ctx->RoundKey, ctx->InvRoundKey, Nr);
+  }
+  BITSLICE_slice_key(ctx->RoundKey, Nr, ctx->SlicedRoundKey);
 }
 #if defined(CBC) && (CBC == 1)
 void AES_init_ctx_iv(struct AES_ctx* ctx, const uint8_t* key, const uint8_t* iv)
 {
-  KeyExpansion(ctx->RoundKey, key);
+  AES_init_ctx(ctx, key);
   memcpy (ctx->Iv, iv, AES_BLOCKLEN);
 }
 void AES_ctx_set_iv(struct AES_ctx* ctx, const uint8_t* iv)
@@ -455,6 +501,31 @@ static void InvCipher(state_t* state,uint8_t* RoundKey)
 }
 
 
+// Encrypt/decrypt a single block with whichever backend is selected.
+static void EncryptBlock(struct AES_ctx* ctx, uint8_t* buf)
+{
+#if AESNI_AVAILABLE
+  if (backend == AES_BACKEND_AESNI)
+  {
+    AESNI_encrypt(ctx->RoundKey, Nr, buf);
+    return;
+  }
+#endif
+  TTABLE_encrypt(ctx->RoundKey, Nr, buf);
+}
+
+static void DecryptBlock(struct AES_ctx* ctx, uint8_t* buf)
+{
+#if AESNI_AVAILABLE
+  if (backend == AES_BACKEND_AESNI)
+  {
+    AESNI_decrypt(ctx->InvRoundKey, Nr, buf);
+    return;
+  }
+#endif
+  TTABLE_decrypt(ctx->InvRoundKey, Nr, buf);
+}
+
 /*****************************************************************************/
 /* Public functions:                                                         */
 /*****************************************************************************/
@@ -464,12 +535,34 @@ static void InvCipher(state_t* state,uint8_t* RoundKey)
 void AES_ECB_encrypt(struct AES_ctx *ctx,const uint8_t* buf)
 {
   // The next function call encrypts the PlainText with the Key using AES algorithm.
-  Cipher((state_t*)buf, ctx->RoundKey);
+  EncryptBlock(ctx, (uint8_t*)buf);
 }
 
 void AES_ECB_decrypt(struct AES_ctx* ctx,const uint8_t* buf)
 {
   // The next function call decrypts the PlainText with the Key using AES algorithm.
+  DecryptBlock(ctx, (uint8_t*)buf);
+}
+
+void AES_ECB_encrypt_x8(struct AES_ctx* ctx, uint8_t* buf)
+{
+#if AESNI_AVAILABLE
+  if (backend == AES_BACKEND_AESNI)
+  {
+    AESNI_encrypt8(ctx->RoundKey, Nr, buf);
+    return;
+  }
+#endif
+  BITSLICE_encrypt8(ctx->SlicedRoundKey, Nr, buf);
+}
+
+void AES_ECB_encrypt_reference(struct AES_ctx* ctx, uint8_t* buf)
+{
+  Cipher((state_t*)buf, ctx->RoundKey);
+}
+
+void AES_ECB_decrypt_reference(struct AES_ctx* ctx, uint8_t* buf)
+{
   InvCipher((state_t*)buf, ctx->RoundKey);
 }
 
@@ -499,7 +592,7 @@ void AES_CBC_encrypt_buffer(struct AES_ctx *ctx,uint8_t* buf, uint32_t length)
   for (i = 0; i < length; i += AES_BLOCKLEN)
   {
     XorWithIv(buf, Iv);
-    Cipher((state_t*)buf, ctx->RoundKey);
+    EncryptBlock(ctx, buf);
     Iv = buf;
     buf += AES_BLOCKLEN;
     //printf("Step %d - %d", i/16, i);
@@ -515,7 +608,7 @@ void AES_CBC_decrypt_buffer(struct AES_ctx* ctx, uint8_t* buf,  uint32_t length)
   for (i = 0; i < length; i += AES_BLOCKLEN)
   {
     memcpy(storeNextIv, buf, AES_BLOCKLEN);
-    InvCipher((state_t*)buf, ctx->RoundKey);
+    DecryptBlock(ctx, buf);
     XorWithIv(buf, ctx->Iv);
     memcpy(ctx->Iv, storeNextIv, AES_BLOCKLEN);
     buf += AES_BLOCKLEN;
@@ -542,7 +635,7 @@ void AES_CTR_xcrypt_buffer(struct AES_ctx* ctx, uint8_t* buf, uint32_t length)
     {
       
       memcpy(buffer, ctx->Iv, AES_BLOCKLEN);
-      Cipher((state_t*)buffer,ctx->RoundKey);
+      EncryptBlock(ctx, buffer);
 
       /* Increment Iv and handle overflow */
       for (bi = (AES_BLOCKLEN - 1); bi >= 0; --bi)
@@ -43,12 +43,36 @@
 struct AES_ctx
 {
   uint8_t RoundKey[AES_keyExpSize];
+  // Decryption schedule for the equivalent inverse cipher, used by both
+  // backends.
+  uint8_t InvRoundKey[AES_keyExpSize];
+  // Bitsliced encryption schedule (16 words per round key), used by
+  // AES_ECB_encrypt_x8 on the T-table backend.
+  uint64_t SlicedRoundKey[AES_keyExpSize];
 #if (defined(CBC) && (CBC == 1)) || (defined(CTR) && (CTR == 1))
   uint8_t Iv[AES_BLOCKLEN];
 #endif
 };
 
 void AES_init_ctx(struct AES_ctx* ctx, const uint8_t* key);
+
+// The block functions below, and the AesCipher class in aes_cipher.h, are
+// backed by one of these. The fastest one the CPU supports is picked at
+// startup: AES-NI if available, otherwise the T-table code. The original
+// byte-wise tiny-AES rounds are kept as a reference implementation.
+enum AES_backend
+{
+  AES_BACKEND_TTABLE = 0,
+  AES_BACKEND_AESNI = 1,
+};
+
+enum AES_backend AES_get_backend(void);
+
+// Force a particular backend, e.g. for known-answer tests or benchmarks.
+// Returns 0 (and leaves the backend alone) if the CPU doesn't support it.
+// Contexts stay valid across a switch; AesCipher objects keep the backend
+// they were created with.
+int AES_set_backend(enum AES_backend backend);
 #if defined(CBC) && (CBC == 1)
 void AES_init_ctx_iv(struct AES_ctx* ctx, const uint8_t* key, const uint8_t* iv);
 void AES_ctx_set_iv(struct AES_ctx* ctx, const uint8_t* iv);
@@ -61,6 +85,18 @@ void AES_ctx_set_iv(struct AES_ctx* ctx, const uint8_t* iv);
 void AES_ECB_encrypt(struct AES_ctx* ctx, const uint8_t* buf);
 void AES_ECB_decrypt(struct AES_ctx* ctx, const uint8_t* buf);
 
+// Encrypt AES_ECB_BATCH consecutive blocks (128 bytes) in one call, as
+// AesCipher::encrypt8() does. With AES-NI the blocks are pipelined; otherwise
+// this uses a bitsliced, constant-time implementation, which is also faster
+// than 8 calls to the T-table code.
+#define AES_ECB_BATCH 8
+void AES_ECB_encrypt_x8(struct AES_ctx* ctx, uint8_t* buf);
+
+// The byte-wise tiny-AES rounds, whatever the backend, for checking the
+// backends against.
+void AES_ECB_encrypt_reference(struct AES_ctx* ctx, uint8_t* buf);
+void AES_ECB_decrypt_reference(struct AES_ctx* ctx, uint8_t* buf);
+
 #endif // #if defined(ECB) && (ECB == !)
 
 
@@ -0,0 +1,316 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "aes_bitslice.h"
+
+#include <string.h>
+
+// Transpose an 8x8 bit matrix: bit 8 * i + j moves to bit 8 * j + i. This is
+// an involution, so it is used both to slice and to unslice.
+static uint64_t transpose8(uint64_t x) {
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+  x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+  x ^= t ^ (t << 28);
+  return x;
+}
+
+// Bit offset of the byte in row r, column c inside a state word.
+static unsigned byte_shift(unsigned r, unsigned c) {
+  return 32 * (r & 1) + 8 * c;
+}
+
+static void slice(const uint8_t* buf, uint64_t q[16]) {
+  memset(q, 0, 16 * sizeof(uint64_t));
+  for (unsigned r = 0; r < 4; r++) {
+    for (unsigned c = 0; c < 4; c++) {
+      uint64_t x = 0;
+      for (unsigned b = 0; b < BITSLICE_BLOCKS; b++) {
+        x |= (uint64_t)buf[16 * b + 4 * c + r] << (8 * b);
+      }
+      x = transpose8(x);
+      for (unsigned j = 0; j < 8; j++) {
+        q[8 * (r >> 1) + j] |= ((x >> (8 * j)) & 0xff) << byte_shift(r, c);
+      }
+    }
+  }
+}
+
+static void unslice(const uint64_t q[16], uint8_t* buf) {
+  for (unsigned r = 0; r < 4; r++) {
+    for (unsigned c = 0; c < 4; c++) {
+      uint64_t x = 0;
+      for (unsigned j = 0; j < 8; j++) {
+        x |= ((q[8 * (r >> 1) + j] >> byte_shift(r, c)) & 0xff) << (8 * j);
+      }
+      x = transpose8(x);
+      for (unsigned b = 0; b < BITSLICE_BLOCKS; b++) {
+        buf[16 * b + 4 * c + r] = (uint8_t)(x >> (8 * b));
+      }
+    }
+  }
+}
+
+void BITSLICE_slice_key(const uint8_t* RoundKey, unsigned rounds,
+                        uint64_t* SlicedRoundKey) {
+  // Every block uses the same key, so each byte of a sliced key word is
+  // either all zeros or all ones.
+  for (unsigned round = 0; round <= rounds; round++) {
+    uint64_t* sk = SlicedRoundKey + 16 * round;
+    memset(sk, 0, 16 * sizeof(uint64_t));
+    for (unsigned r = 0; r < 4; r++) {
+      for (unsigned c = 0; c < 4; c++) {
+        const uint8_t k = RoundKey[16 * round + 4 * c + r];
+        for (unsigned j = 0; j < 8; j++) {
+          const uint64_t mask = (uint64_t)0 - ((k >> j) & 1);
+          sk[8 * (r >> 1) + j] |= (mask & 0xff) << byte_shift(r, c);
+        }
+      }
+    }
+  }
+}
+
+// The AES S-box as a boolean circuit, from Boyar and Peralta, "A depth-16
+// circuit for the AES S-box". q[j] holds bit j of each input byte.
+static void sub_bytes(uint64_t* q) {
+  uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+  uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+  uint64_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+  uint64_t y20, y21;
+  uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+  uint64_t z10, z11, z12, z13, z14, z15, z16, z17;
+  uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+  uint64_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+  uint64_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+  uint64_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+  uint64_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+  uint64_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+  uint64_t t60, t61, t62, t63, t64, t65, t66, t67;
+  uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+  x0 = q[7];
+  x1 = q[6];
+  x2 = q[5];
+  x3 = q[4];
+  x4 = q[3];
+  x5 = q[2];
+  x6 = q[1];
+  x7 = q[0];
+
+  // Top linear transformation.
+  y14 = x3 ^ x5;
+  y13 = x0 ^ x6;
+  y9 = x0 ^ x3;
+  y8 = x0 ^ x5;
+  t0 = x1 ^ x2;
+  y1 = t0 ^ x7;
+  y4 = y1 ^ x3;
+  y12 = y13 ^ y14;
+  y2 = y1 ^ x0;
+  y5 = y1 ^ x6;
+  y3 = y5 ^ y8;
+  t1 = x4 ^ y12;
+  y15 = t1 ^ x5;
+  y20 = t1 ^ x1;
+  y6 = y15 ^ x7;
+  y10 = y15 ^ t0;
+  y11 = y20 ^ y9;
+  y7 = x7 ^ y11;
+  y17 = y10 ^ y11;
+  y19 = y10 ^ y8;
+  y16 = t0 ^ y11;
+  y21 = y13 ^ y16;
+  y18 = x0 ^ y16;
+
+  // Non-linear section.
+  t2 = y12 & y15;
+  t3 = y3 & y6;
+  t4 = t3 ^ t2;
+  t5 = y4 & x7;
+  t6 = t5 ^ t2;
+  t7 = y13 & y16;
+  t8 = y5 & y1;
+  t9 = t8 ^ t7;
+  t10 = y2 & y7;
+  t11 = t10 ^ t7;
+  t12 = y9 & y11;
+  t13 = y14 & y17;
+  t14 = t13 ^ t12;
+  t15 = y8 & y10;
+  t16 = t15 ^ t12;
+  t17 = t4 ^ t14;
+  t18 = t6 ^ t16;
+  t19 = t9 ^ t14;
+  t20 = t11 ^ t16;
+  t21 = t17 ^ y20;
+  t22 = t18 ^ y19;
+  t23 = t19 ^ y21;
+  t24 = t20 ^ y18;
+
+  t25 = t21 ^ t22;
+  t26 = t21 & t23;
+  t27 = t24 ^ t26;
+  t28 = t25 & t27;
+  t29 = t28 ^ t22;
+  t30 = t23 ^ t24;
+  t31 = t22 ^ t26;
+  t32 = t31 & t30;
+  t33 = t32 ^ t24;
+  t34 = t23 ^ t33;
+  t35 = t27 ^ t33;
+  t36 = t24 & t35;
+  t37 = t36 ^ t34;
+  t38 = t27 ^ t36;
+  t39 = t29 & t38;
+  t40 = t25 ^ t39;
+
+  t41 = t40 ^ t37;
+  t42 = t29 ^ t33;
+  t43 = t29 ^ t40;
+  t44 = t33 ^ t37;
+  t45 = t42 ^ t41;
+  z0 = t44 & y15;
+  z1 = t37 & y6;
+  z2 = t33 & x7;
+  z3 = t43 & y16;
+  z4 = t40 & y1;
+  z5 = t29 & y7;
+  z6 = t42 & y11;
+  z7 = t45 & y17;
+  z8 = t41 & y10;
+  z9 = t44 & y12;
+  z10 = t37 & y3;
+  z11 = t33 & y4;
+  z12 = t43 & y13;
+  z13 = t40 & y5;
+  z14 = t29 & y2;
+  z15 = t42 & y9;
+  z16 = t45 & y14;
+  z17 = t41 & y8;
+
+  // Bottom linear transformation.
+  t46 = z15 ^ z16;
+  t47 = z10 ^ z11;
+  t48 = z5 ^ z13;
+  t49 = z9 ^ z10;
+  t50 = z2 ^ z12;
+  t51 = z2 ^ z5;
+  t52 = z7 ^ z8;
+  t53 = z0 ^ z3;
+  t54 = z6 ^ z7;
+  t55 = z16 ^ z17;
+  t56 = z12 ^ t48;
+  t57 = t50 ^ t53;
+  t58 = z4 ^ t46;
+  t59 = z3 ^ t54;
+  t60 = t46 ^ t57;
+  t61 = z14 ^ t57;
+  t62 = t52 ^ t58;
+  t63 = t49 ^ t58;
+  t64 = z4 ^ t59;
+  t65 = t61 ^ t62;
+  t66 = z1 ^ t63;
+  s0 = t59 ^ t63;
+  s6 = t56 ^ ~t62;
+  s7 = t48 ^ ~t60;
+  t67 = t64 ^ t65;
+  s3 = t53 ^ t66;
+  s4 = t51 ^ t66;
+  s5 = t47 ^ t65;
+  s1 = t64 ^ ~s3;
+  s2 = t55 ^ ~t67;
+
+  q[7] = s0;
+  q[6] = s1;
+  q[5] = s2;
+  q[4] = s3;
+  q[3] = s4;
+  q[2] = s5;
+  q[1] = s6;
+  q[0] = s7;
+}
+
+static uint32_t rotr32(uint32_t x, unsigned n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+// Row r of every word is rotated right by r bytes, which moves column c + r
+// into column c.
+static void shift_rows(uint64_t q[16]) {
+  for (unsigned j = 0; j < 8; j++) {
+    const uint64_t lo = q[j], hi = q[8 + j];
+    q[j] = (lo & 0xffffffffULL) | ((uint64_t)rotr32(lo >> 32, 8) << 32);
+    q[8 + j] = (uint64_t)rotr32((uint32_t)hi, 16) |
+               ((uint64_t)rotr32(hi >> 32, 24) << 32);
+  }
+}
+
+// b[r] = 2 * (a[r] ^ a[r + 1]) ^ a[r + 1] ^ a[r + 2] ^ a[r + 3]
+static void mix_columns(uint64_t q[16]) {
+  uint64_t t[16], u[16];
+  for (unsigned j = 0; j < 8; j++) {
+    const uint64_t lo = q[j], hi = q[8 + j];
+    // The state rotated up by one row; rotating by two just swaps lo and hi.
+    const uint64_t rlo = (lo >> 32) | (hi << 32);
+    const uint64_t rhi = (hi >> 32) | (lo << 32);
+    t[j] = lo ^ rlo;
+    t[8 + j] = hi ^ rhi;
+    u[j] = rlo ^ hi ^ rhi;
+    u[8 + j] = rhi ^ lo ^ rlo;
+  }
+  for (unsigned h = 0; h < 16; h += 8) {
+    // Multiplication by x, reducing by x^8 + x^4 + x^3 + x + 1.
+    const uint64_t* a = t + h;
+    const uint64_t* b = u + h;
+    q[h + 0] = a[7] ^ b[0];
+    q[h + 1] = a[0] ^ a[7] ^ b[1];
+    q[h + 2] = a[1] ^ b[2];
+    q[h + 3] = a[2] ^ a[7] ^ b[3];
+    q[h + 4] = a[3] ^ a[7] ^ b[4];
+    q[h + 5] = a[4] ^ b[5];
+    q[h + 6] = a[5] ^ b[6];
+    q[h + 7] = a[6] ^ b[7];
+  }
+}
+
+static void add_round_key(uint64_t q[16], const uint64_t* sk) {
+  for (unsigned i = 0; i < 16; i++) {
+    q[i] ^= sk[i];
+  }
+}
+
+void BITSLICE_encrypt8(const uint64_t* SlicedRoundKey, unsigned rounds,
+                       uint8_t* buf) {
+  uint64_t q[16];
+  slice(buf, q);
+  add_round_key(q, SlicedRoundKey);
+  for (unsigned round = 1; round < rounds; round++) {
+    sub_bytes(q);
+    sub_bytes(q + 8);
+    shift_rows(q);
+    mix_columns(q);
+    add_round_key(q, SlicedRoundKey + 16 * round);
+  }
+  sub_bytes(q);
+  sub_bytes(q + 8);
+  shift_rows(q);
+  add_round_key(q, SlicedRoundKey + 16 * rounds);
+  unslice(q, buf);
+}
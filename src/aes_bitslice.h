@@ -0,0 +1,51 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+// Bitsliced AES encryption of 8 independent blocks at a time. The state is
+// kept as 16 64-bit words: word 8*h + j holds bit j of every byte in rows
+// 2*h and 2*h + 1 of all 8 blocks. SubBytes is evaluated as a boolean
+// circuit (Boyar-Peralta), ShiftRows and MixColumns become shifts and
+// rotations, and there are no data-dependent table lookups or branches.
+//
+// The sliced round keys are derived from a tiny-AES style expanded key, so
+// only the key schedule itself goes through the S-box table.
+
+#ifndef _AES_BITSLICE_H_
+#define _AES_BITSLICE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of blocks processed by BITSLICE_encrypt8().
+#define BITSLICE_BLOCKS 8
+
+// Slice an expanded key into 16 * (rounds + 1) words.
+void BITSLICE_slice_key(const uint8_t* RoundKey, unsigned rounds,
+                        uint64_t* SlicedRoundKey);
+
+// Encrypt BITSLICE_BLOCKS consecutive blocks in place.
+void BITSLICE_encrypt8(const uint64_t* SlicedRoundKey, unsigned rounds,
+                       uint8_t* buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_AES_BITSLICE_H_
@@ -0,0 +1,79 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+#include "./aes_cipher.h"
+
+#include <array>
+
+namespace cryptopals {
+
+template <size_t KeyBits>
+static AesCipher<KeyBits> make_cipher(const std::string &key) {
+  return AesCipher<KeyBits>(reinterpret_cast<const uint8_t *>(key.data()));
+}
+
+static std::variant<AesCipher<128>, AesCipher<192>, AesCipher<256>>
+expand_key(const std::string &key) {
+  switch (key.size()) {
+    case AesCipher<192>::kKeyLength:
+      return make_cipher<192>(key);
+    case AesCipher<256>::kKeyLength:
+      return make_cipher<256>(key);
+    default:
+      assert(key.size() == AesCipher<128>::kKeyLength);
+      return make_cipher<128>(key);
+  }
+}
+
+AesKey::AesKey(const std::string &key) : cipher_(expand_key(key)) {}
+
+size_t AesKey::size() const {
+  size_t size = 0;
+  visit([&size](const auto &cipher) { size = cipher.kKeyLength; });
+  return size;
+}
+
+AES_backend AesKey::backend() const {
+  AES_backend backend = AES_BACKEND_TTABLE;
+  visit([&backend](const auto &cipher) { backend = cipher.backend(); });
+  return backend;
+}
+
+std::shared_ptr<const AesKey> AesKey::cached(const std::string &key) {
+  // Attacks usually hammer one or two keys, so a few entries with round robin
+  // replacement is plenty.
+  struct Entry {
+    std::string key;
+    AES_backend backend;
+    std::shared_ptr<const AesKey> expanded;
+  };
+  static thread_local std::array<Entry, 8> cache;
+  static thread_local size_t next = 0;
+
+  // the backend is baked in when a key is expanded
+  const AES_backend backend = AES_get_backend();
+  for (const auto &entry : cache) {
+    if (entry.expanded && entry.backend == backend && entry.key == key) {
+      return entry.expanded;
+    }
+  }
+  Entry &entry = cache[next++ % cache.size()];
+  entry.key = key;
+  entry.backend = backend;
+  entry.expanded = std::make_shared<const AesKey>(key);
+  return entry.expanded;
+}
+}  // namespace cryptopals
@@ -0,0 +1,211 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "./aes.hpp"
+#include "./aes_bitslice.h"
+#include "./aes_ni.h"
+#include "./aes_ttable.h"
+
+namespace cryptopals {
+
+// AES with the key size fixed at compile time. Unlike the tiny-AES interface
+// in aes.h, which is built for a single key size, all three specializations
+// can be used from the same binary. The software key expansion and rounds are
+// fully unrolled; with AES-NI the schedule comes from AESKEYGENASSIST instead.
+// The block functions use the backend AES_get_backend() names when the cipher
+// is constructed.
+template <size_t KeyBits>
+class AesCipher {
+  static_assert(KeyBits == 128 || KeyBits == 192 || KeyBits == 256,
+                "AES keys are 128, 192 or 256 bits");
+
+ public:
+  static constexpr size_t kKeyLength = KeyBits / 8;
+  static constexpr unsigned kRounds = KeyBits / 32 + 6;
+  static constexpr size_t kScheduleSize = AES_BLOCKLEN * (kRounds + 1);
+
+  // key must point at kKeyLength bytes
+  explicit AesCipher(const uint8_t *key) : backend_(AES_get_backend()) {
+#if AESNI_AVAILABLE
+    if (backend_ == AES_BACKEND_AESNI) {
+      if constexpr (KeyBits == 128) {
+        AESNI_expand_key128(key, enc_);
+      } else if constexpr (KeyBits == 192) {
+        AESNI_expand_key192(key, enc_);
+      } else {
+        AESNI_expand_key256(key, enc_);
+      }
+      AESNI_invert_key(enc_, dec_, kRounds);
+      return;
+    }
+#endif
+    expand_key(key, std::make_index_sequence<4 * (kRounds + 1) - kNk>{});
+    TTABLE_invert_key(enc_, dec_, kRounds);
+    BITSLICE_slice_key(enc_, kRounds, sliced_);
+  }
+
+  inline AES_backend backend() const { return backend_; }
+
+  // encrypt/decrypt a single block in place
+  inline void encrypt(uint8_t *block) const {
+#if AESNI_AVAILABLE
+    if (backend_ == AES_BACKEND_AESNI) {
+      AESNI_encrypt(enc_, kRounds, block);
+      return;
+    }
+#endif
+    uint32_t s[4];
+    TTABLE_load_block(s, block, enc_);
+    encrypt_rounds(s, std::make_index_sequence<kRounds - 1>{});
+    TTABLE_enc_last(s, enc_ + AES_BLOCKLEN * kRounds, block);
+  }
+
+  inline void decrypt(uint8_t *block) const {
+#if AESNI_AVAILABLE
+    if (backend_ == AES_BACKEND_AESNI) {
+      AESNI_decrypt(dec_, kRounds, block);
+      return;
+    }
+#endif
+    uint32_t s[4];
+    TTABLE_load_block(s, block, dec_);
+    decrypt_rounds(s, std::make_index_sequence<kRounds - 1>{});
+    TTABLE_dec_last(s, dec_ + AES_BLOCKLEN * kRounds, block);
+  }
+
+  // encrypt AES_ECB_BATCH consecutive blocks in place
+  inline void encrypt8(uint8_t *blocks) const {
+#if AESNI_AVAILABLE
+    if (backend_ == AES_BACKEND_AESNI) {
+      AESNI_encrypt8(enc_, kRounds, blocks);
+      return;
+    }
+#endif
+    BITSLICE_encrypt8(sliced_, kRounds, blocks);
+  }
+
+  // encrypt blocks[i] with *ciphers[i], for n <= AES_ECB_BATCH ciphers that
+  // were all created with the same backend; the blocks are interleaved so
+  // unrelated messages can share the AES pipeline
+  static inline void encrypt_lanes(const AesCipher *const *ciphers,
+                                   uint8_t *const *blocks, size_t n) {
+    assert(n <= AES_ECB_BATCH);
+#if AESNI_AVAILABLE
+    if (n && ciphers[0]->backend_ == AES_BACKEND_AESNI) {
+      const uint8_t *schedules[AES_ECB_BATCH];
+      for (size_t i = 0; i < n; i++) {
+        schedules[i] = ciphers[i]->enc_;
+      }
+      AESNI_encrypt_lanes(schedules, kRounds, blocks, n);
+      return;
+    }
+#endif
+    for (size_t i = 0; i < n; i++) {
+      ciphers[i]->encrypt(blocks[i]);
+    }
+  }
+
+ private:
+  static constexpr unsigned kNk = KeyBits / 32;
+
+  AES_backend backend_;
+  uint8_t enc_[kScheduleSize];
+  uint8_t dec_[kScheduleSize];
+  uint64_t sliced_[kScheduleSize];
+
+  static inline uint32_t sub_word(uint32_t w) {
+    return (uint32_t(TTABLE_Te4[w >> 24]) << 24) |
+           (uint32_t(TTABLE_Te4[(w >> 16) & 0xff]) << 16) |
+           (uint32_t(TTABLE_Te4[(w >> 8) & 0xff]) << 8) |
+           TTABLE_Te4[w & 0xff];
+  }
+
+  // compute word I of the schedule from the ones before it
+  template <size_t I>
+  inline void expand_word() {
+    static constexpr uint8_t rcon[] = {0x01, 0x02, 0x04, 0x08, 0x10,
+                                       0x20, 0x40, 0x80, 0x1b, 0x36};
+    uint32_t w = TTABLE_load32(enc_ + 4 * (I - 1));
+    if constexpr (I % kNk == 0) {
+      w = sub_word((w << 8) | (w >> 24)) ^
+          (uint32_t(rcon[I / kNk - 1]) << 24);
+    } else if constexpr (kNk > 6 && I % kNk == 4) {
+      w = sub_word(w);
+    }
+    TTABLE_store32(enc_ + 4 * I, w ^ TTABLE_load32(enc_ + 4 * (I - kNk)));
+  }
+
+  template <size_t... I>
+  inline void expand_key(const uint8_t *key, std::index_sequence<I...>) {
+    for (size_t i = 0; i < kKeyLength; i++) {
+      enc_[i] = key[i];
+    }
+    (expand_word<kNk + I>(), ...);
+  }
+
+  template <size_t... I>
+  inline void encrypt_rounds(uint32_t s[4], std::index_sequence<I...>) const {
+    (TTABLE_enc_round(s, enc_ + AES_BLOCKLEN * (I + 1)), ...);
+  }
+
+  template <size_t... I>
+  inline void decrypt_rounds(uint32_t s[4], std::index_sequence<I...>) const {
+    (TTABLE_dec_round(s, dec_ + AES_BLOCKLEN * (I + 1)), ...);
+  }
+};
+
+// An AES key of any size, expanded once. Building one of these does all of
+// the key setup, so code that uses the same key repeatedly should hold on to
+// it rather than passing the raw key around. The backend is fixed then too:
+// a key expanded for AES-NI keeps using it after CPU_set_tier() drops below
+// the SSE tier, so expand keys again after changing the tier.
+class AesKey {
+ public:
+  // key must be 16, 24 or 32 bytes
+  explicit AesKey(const std::string &key);
+
+  // A shared AesKey for key, from a small per-thread cache of recently used
+  // keys. This is what the std::string overloads in Buffer use. Entries are
+  // per backend, so the key is expanded again when the tier changes it.
+  static std::shared_ptr<const AesKey> cached(const std::string &key);
+
+  // key size in bytes
+  size_t size() const;
+
+  // the backend the key was expanded for
+  AES_backend backend() const;
+
+  // Call f with the AesCipher specialization for this key.
+  template <typename F>
+  inline void visit(F &&f) const {
+    std::visit(std::forward<F>(f), cipher_);
+  }
+
+ private:
+  std::variant<AesCipher<128>, AesCipher<192>, AesCipher<256>> cipher_;
+};
+}  // namespace cryptopals
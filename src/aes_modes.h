@@ -0,0 +1,116 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "./aes.hpp"
+
+namespace cryptopals {
+
+// Block cipher modes over raw memory, for any cipher with the AesCipher
+// interface. Sizes are in bytes; except for CTR they must be a multiple of
+// AES_BLOCKLEN. Padding is up to the caller.
+
+inline void xor_inplace(uint8_t *target, const uint8_t *iv) {
+  for (size_t i = 0; i < AES_BLOCKLEN; i++) {
+    *(target + i) ^= *(iv + i);
+  }
+}
+
+inline void store_le64(uint8_t *out, uint64_t val) {
+  for (size_t i = 0; i < 8; i++) {
+    out[i] = static_cast<uint8_t>(val >> (8 * i));
+  }
+}
+
+template <typename Cipher>
+inline void ecb_encrypt(const Cipher &cipher, uint8_t *data, size_t size) {
+  // ECB blocks are independent, so do as many as possible in batches
+  const size_t batch = AES_BLOCKLEN * AES_ECB_BATCH;
+  size_t i = 0;
+  for (; i + batch <= size; i += batch) {
+    cipher.encrypt8(data + i);
+  }
+  for (; i < size; i += AES_BLOCKLEN) {
+    cipher.encrypt(data + i);
+  }
+}
+
+// CBC encrypt/decrypt in place. iv is left holding the last ciphertext block,
+// so the next call carries on the same chain.
+template <typename Cipher>
+inline void cbc_encrypt(const Cipher &cipher, uint8_t *iv, uint8_t *data,
+                        size_t size) {
+  for (size_t i = 0; i < size; i += AES_BLOCKLEN) {
+    xor_inplace(data + i, iv);
+    cipher.encrypt(data + i);
+    std::memmove(iv, data + i, AES_BLOCKLEN);
+  }
+}
+
+template <typename Cipher>
+inline void cbc_decrypt(const Cipher &cipher, uint8_t *iv, uint8_t *data,
+                        size_t size) {
+  uint8_t iv_copy[AES_BLOCKLEN];
+  for (size_t i = 0; i < size; i += AES_BLOCKLEN) {
+    uint8_t *ptr = data + i;
+    std::memmove(iv_copy, ptr, AES_BLOCKLEN);
+    cipher.decrypt(ptr);
+    xor_inplace(ptr, iv);
+    std::memmove(iv, iv_copy, AES_BLOCKLEN);
+  }
+}
+
+// XOR size bytes at data with the keystream starting at byte offset.
+template <typename Cipher>
+inline void ctr_xcrypt(const Cipher &cipher, uint64_t nonce, uint64_t offset,
+                       uint8_t *data, size_t size) {
+  uint8_t keystream[AES_BLOCKLEN * AES_ECB_BATCH];
+  uint64_t counter = offset / AES_BLOCKLEN;
+  size_t skip = offset % AES_BLOCKLEN;
+  while (size) {
+    // generate a full batch of keystream unless only a few blocks are left
+    const size_t want = (skip + size + AES_BLOCKLEN - 1) / AES_BLOCKLEN;
+    const size_t blocks = std::min<size_t>(want, AES_ECB_BATCH);
+    for (size_t i = 0; i < blocks; i++) {
+      store_le64(keystream + i * AES_BLOCKLEN, nonce);
+      store_le64(keystream + i * AES_BLOCKLEN + 8, counter + i);
+    }
+    if (blocks == AES_ECB_BATCH) {
+      cipher.encrypt8(keystream);
+    } else {
+      for (size_t i = 0; i < blocks; i++) {
+        cipher.encrypt(keystream + i * AES_BLOCKLEN);
+      }
+    }
+
+    const size_t n = std::min(size, blocks * AES_BLOCKLEN - skip);
+    for (size_t i = 0; i < n; i++) {
+      data[i] ^= keystream[skip + i];
+    }
+    data += n;
+    size -= n;
+    counter += blocks;
+    skip = 0;
+  }
+}
+}  // namespace cryptopals
@@ -0,0 +1,208 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+#include "aes_ni.h"
+
+#if AESNI_AVAILABLE
+
+#include <wmmintrin.h>
+
+#include "cpu.h"
+
+// The build doesn't assume any particular ISA, so everything that touches the
+// AES instructions is compiled for it explicitly and only called after
+// AESNI_supported() says it's safe.
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+
+int AESNI_supported(void) {
+  return CPU_has(CPU_AESNI);
+}
+
+// One step of the key expansion: XOR each word of key into the ones after
+// it, then XOR in word, which is the SubWord/RotWord/rcon term for the first
+// of them broadcast to every lane.
+AESNI_TARGET static inline __m128i expand_step(__m128i key, __m128i word) {
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, word);
+}
+
+// The round constant is an immediate operand of AESKEYGENASSIST, so the
+// expansions have to be unrolled with macros rather than loops. Lane 0xff is
+// RotWord(SubWord(w3)) ^ rcon, 0xaa is SubWord(w3) and 0x55 is
+// RotWord(SubWord(w1)) ^ rcon.
+#define ASSIST(k, rcon, lane) \
+  _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k, rcon), lane)
+
+#define EXPAND128(i, rcon) \
+  rk[i] = expand_step(rk[i - 1], ASSIST(rk[i - 1], rcon, 0xff))
+
+AESNI_TARGET void AESNI_expand_key128(const uint8_t* key, uint8_t* RoundKey) {
+  __m128i rk[11];
+  rk[0] = _mm_loadu_si128((const __m128i*)key);
+  EXPAND128(1, 0x01);
+  EXPAND128(2, 0x02);
+  EXPAND128(3, 0x04);
+  EXPAND128(4, 0x08);
+  EXPAND128(5, 0x10);
+  EXPAND128(6, 0x20);
+  EXPAND128(7, 0x40);
+  EXPAND128(8, 0x80);
+  EXPAND128(9, 0x1b);
+  EXPAND128(10, 0x36);
+  for (unsigned i = 0; i <= 10; i++) {
+    _mm_storeu_si128((__m128i*)(RoundKey + i * 16), rk[i]);
+  }
+}
+
+// A 192-bit schedule advances six words at a time: four in lo and two in the
+// low half of hi. Those are stored at a 24 byte stride, except that the last
+// step only needs lo.
+#define EXPAND192(i, rcon)                                              \
+  do {                                                                  \
+    lo = expand_step(lo, ASSIST(hi, rcon, 0x55));                       \
+    hi = _mm_xor_si128(hi, _mm_slli_si128(hi, 4));                      \
+    hi = _mm_xor_si128(hi, _mm_shuffle_epi32(lo, 0xff));                \
+    _mm_storeu_si128((__m128i*)(RoundKey + 24 * i), lo);                \
+    if (i < 8) _mm_storel_epi64((__m128i*)(RoundKey + 24 * i + 16), hi); \
+  } while (0)
+
+AESNI_TARGET void AESNI_expand_key192(const uint8_t* key, uint8_t* RoundKey) {
+  __m128i lo = _mm_loadu_si128((const __m128i*)key);
+  __m128i hi = _mm_loadl_epi64((const __m128i*)(key + 16));
+  _mm_storeu_si128((__m128i*)RoundKey, lo);
+  _mm_storel_epi64((__m128i*)(RoundKey + 16), hi);
+  EXPAND192(1, 0x01);
+  EXPAND192(2, 0x02);
+  EXPAND192(3, 0x04);
+  EXPAND192(4, 0x08);
+  EXPAND192(5, 0x10);
+  EXPAND192(6, 0x20);
+  EXPAND192(7, 0x40);
+  EXPAND192(8, 0x80);
+}
+
+// A 256-bit schedule alternates between the rcon step and a plain SubWord
+// step, each producing one round key from the two before it.
+#define EXPAND256(i, rcon)                                          \
+  rk[i] = expand_step(rk[i - 2], ASSIST(rk[i - 1], rcon, 0xff)); \
+  rk[i + 1] = expand_step(rk[i - 1], ASSIST(rk[i], 0, 0xaa))
+
+AESNI_TARGET void AESNI_expand_key256(const uint8_t* key, uint8_t* RoundKey) {
+  __m128i rk[15];
+  rk[0] = _mm_loadu_si128((const __m128i*)key);
+  rk[1] = _mm_loadu_si128((const __m128i*)(key + 16));
+  EXPAND256(2, 0x01);
+  EXPAND256(4, 0x02);
+  EXPAND256(6, 0x04);
+  EXPAND256(8, 0x08);
+  EXPAND256(10, 0x10);
+  EXPAND256(12, 0x20);
+  rk[14] = expand_step(rk[12], ASSIST(rk[13], 0x40, 0xff));
+  for (unsigned i = 0; i <= 14; i++) {
+    _mm_storeu_si128((__m128i*)(RoundKey + i * 16), rk[i]);
+  }
+}
+
+#undef EXPAND256
+#undef EXPAND192
+#undef EXPAND128
+#undef ASSIST
+
+AESNI_TARGET void AESNI_invert_key(const uint8_t* RoundKey,
+                                   uint8_t* InvRoundKey, unsigned rounds) {
+  const __m128i* rk = (const __m128i*)RoundKey;
+  __m128i* dk = (__m128i*)InvRoundKey;
+  _mm_storeu_si128(dk, _mm_loadu_si128(rk + rounds));
+  for (unsigned i = 1; i < rounds; i++) {
+    const __m128i k = _mm_loadu_si128(rk + rounds - i);
+    _mm_storeu_si128(dk + i, _mm_aesimc_si128(k));
+  }
+  _mm_storeu_si128(dk + rounds, _mm_loadu_si128(rk));
+}
+
+AESNI_TARGET void AESNI_encrypt(const uint8_t* RoundKey, unsigned rounds,
+                                uint8_t* buf) {
+  const __m128i* rk = (const __m128i*)RoundKey;
+  __m128i m = _mm_xor_si128(_mm_loadu_si128((const __m128i*)buf),
+                            _mm_loadu_si128(rk));
+  for (unsigned i = 1; i < rounds; i++) {
+    m = _mm_aesenc_si128(m, _mm_loadu_si128(rk + i));
+  }
+  m = _mm_aesenclast_si128(m, _mm_loadu_si128(rk + rounds));
+  _mm_storeu_si128((__m128i*)buf, m);
+}
+
+AESNI_TARGET void AESNI_encrypt8(const uint8_t* RoundKey, unsigned rounds,
+                                 uint8_t* buf) {
+  const __m128i* rk = (const __m128i*)RoundKey;
+  __m128i* blocks = (__m128i*)buf;
+  __m128i m[8];
+  __m128i k = _mm_loadu_si128(rk);
+  for (unsigned j = 0; j < 8; j++) {
+    m[j] = _mm_xor_si128(_mm_loadu_si128(blocks + j), k);
+  }
+  for (unsigned i = 1; i < rounds; i++) {
+    k = _mm_loadu_si128(rk + i);
+    for (unsigned j = 0; j < 8; j++) {
+      m[j] = _mm_aesenc_si128(m[j], k);
+    }
+  }
+  k = _mm_loadu_si128(rk + rounds);
+  for (unsigned j = 0; j < 8; j++) {
+    _mm_storeu_si128(blocks + j, _mm_aesenclast_si128(m[j], k));
+  }
+}
+
+AESNI_TARGET void AESNI_encrypt_lanes(const uint8_t* const* RoundKeys,
+                                      unsigned rounds, uint8_t* const* blocks,
+                                      unsigned n) {
+  __m128i m[8];
+  for (unsigned j = 0; j < n; j++) {
+    m[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i*)blocks[j]),
+                         _mm_loadu_si128((const __m128i*)RoundKeys[j]));
+  }
+  for (unsigned i = 1; i < rounds; i++) {
+    for (unsigned j = 0; j < n; j++) {
+      const __m128i* rk = (const __m128i*)RoundKeys[j];
+      m[j] = _mm_aesenc_si128(m[j], _mm_loadu_si128(rk + i));
+    }
+  }
+  for (unsigned j = 0; j < n; j++) {
+    const __m128i* rk = (const __m128i*)RoundKeys[j];
+    m[j] = _mm_aesenclast_si128(m[j], _mm_loadu_si128(rk + rounds));
+    _mm_storeu_si128((__m128i*)blocks[j], m[j]);
+  }
+}
+
+AESNI_TARGET void AESNI_decrypt(const uint8_t* InvRoundKey, unsigned rounds,
+                                uint8_t* buf) {
+  const __m128i* dk = (const __m128i*)InvRoundKey;
+  __m128i m = _mm_xor_si128(_mm_loadu_si128((const __m128i*)buf),
+                            _mm_loadu_si128(dk));
+  for (unsigned i = 1; i < rounds; i++) {
+    m = _mm_aesdec_si128(m, _mm_loadu_si128(dk + i));
+  }
+  m = _mm_aesdeclast_si128(m, _mm_loadu_si128(dk + rounds));
+  _mm_storeu_si128((__m128i*)buf, m);
+}
+
+#else
+
+int AESNI_supported(void) { return 0; }
+
+#endif  // AESNI_AVAILABLE
@@ -0,0 +1,71 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+// AES-NI backend for the block functions in aes.h and for AesCipher in
+// aes_cipher.h. Round keys use the same byte layout as tiny-AES, so the
+// encryption schedule is interchangeable; the decryption schedule is the
+// "equivalent inverse cipher" one (AESIMC applied to the inner round keys, in
+// reverse order).
+
+#ifndef _AES_NI_H_
+#define _AES_NI_H_
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AESNI_AVAILABLE 1
+#else
+#define AESNI_AVAILABLE 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns non-zero if the CPU supports the AES-NI instructions.
+int AESNI_supported(void);
+
+#if AESNI_AVAILABLE
+// Expand a 128, 192 or 256-bit key into the encryption schedule (176, 208 or
+// 240 bytes) with AESKEYGENASSIST.
+void AESNI_expand_key128(const uint8_t* key, uint8_t* RoundKey);
+void AESNI_expand_key192(const uint8_t* key, uint8_t* RoundKey);
+void AESNI_expand_key256(const uint8_t* key, uint8_t* RoundKey);
+
+// Derive the decryption schedule from an already expanded encryption schedule.
+void AESNI_invert_key(const uint8_t* RoundKey, uint8_t* InvRoundKey,
+                      unsigned rounds);
+
+// Encrypt/decrypt a single block in place.
+void AESNI_encrypt(const uint8_t* RoundKey, unsigned rounds, uint8_t* buf);
+void AESNI_decrypt(const uint8_t* InvRoundKey, unsigned rounds, uint8_t* buf);
+
+// Encrypt 8 consecutive blocks in place, interleaving the rounds so the AES
+// unit stays busy.
+void AESNI_encrypt8(const uint8_t* RoundKey, unsigned rounds, uint8_t* buf);
+
+// Encrypt one block under each of n (at most 8) different keys, interleaving
+// the rounds. Used to keep the pipeline full when encrypting independent
+// messages in a serial mode like CBC.
+void AESNI_encrypt_lanes(const uint8_t* const* RoundKeys, unsigned rounds,
+                         uint8_t* const* blocks, unsigned n);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_AES_NI_H_
@@ -0,0 +1,149 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "./aes_stream.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "./aes_cipher.h"
+#include "./aes_modes.h"
+
+namespace cryptopals {
+
+AesStream::AesStream(std::shared_ptr<const AesKey> key, Mode mode,
+                     const std::string &iv, uint64_t nonce, bool pkcs7)
+    : key_(std::move(key)),
+      mode_(mode),
+      pkcs7_(pkcs7 && mode != CTR_XCRYPT),
+      nonce_(nonce),
+      offset_(0) {
+  assert(iv.empty() || iv.size() == AES_BLOCKLEN);
+  std::memset(iv_, 0, AES_BLOCKLEN);
+  std::memmove(iv_, iv.data(), iv.size());
+}
+
+AesStream::AesStream(const std::string &key, Mode mode, const std::string &iv,
+                     uint64_t nonce, bool pkcs7)
+    : AesStream(AesKey::cached(key), mode, iv, nonce, pkcs7) {}
+
+void AesStream::update(const uint8_t *data, size_t size,
+                       std::vector<uint8_t> *out) {
+  // work in place at the end of out, starting with what was held back
+  const size_t start = out->size();
+  out->insert(out->end(), pending_.begin(), pending_.end());
+  out->insert(out->end(), data, data + size);
+  pending_.clear();
+
+  const size_t avail = out->size() - start;
+  size_t ready = avail;
+  if (mode_ != CTR_XCRYPT) {
+    ready -= avail % AES_BLOCKLEN;
+    if (mode_ == CBC_DECRYPT && pkcs7_ && ready == avail && ready) {
+      ready -= AES_BLOCKLEN;
+    }
+    pending_.assign(out->begin() + start + ready, out->end());
+    out->resize(start + ready);
+  }
+
+  uint8_t *ptr = out->data() + start;
+  key_->visit([&](const auto &cipher) {
+    switch (mode_) {
+      case CBC_ENCRYPT:
+        cbc_encrypt(cipher, iv_, ptr, ready);
+        break;
+      case CBC_DECRYPT:
+        cbc_decrypt(cipher, iv_, ptr, ready);
+        break;
+      case CTR_XCRYPT:
+        ctr_xcrypt(cipher, nonce_, offset_, ptr, ready);
+        break;
+    }
+  });
+  offset_ += ready;
+}
+
+bool AesStream::finish(std::vector<uint8_t> *out) {
+  if (mode_ == CBC_ENCRYPT && pkcs7_) {
+    const uint8_t padval = AES_BLOCKLEN - pending_.size() % AES_BLOCKLEN;
+    pending_.insert(pending_.end(), padval, padval);
+  }
+  if (pending_.size() % AES_BLOCKLEN) {
+    // truncated ciphertext, or unpadded input that isn't whole blocks
+    pending_.clear();
+    return false;
+  }
+
+  const size_t start = out->size();
+  out->insert(out->end(), pending_.begin(), pending_.end());
+  key_->visit([&](const auto &cipher) {
+    if (mode_ == CBC_ENCRYPT) {
+      cbc_encrypt(cipher, iv_, out->data() + start, pending_.size());
+    } else if (mode_ == CBC_DECRYPT) {
+      cbc_decrypt(cipher, iv_, out->data() + start, pending_.size());
+    }
+  });
+  offset_ += pending_.size();
+  pending_.clear();
+
+  if (mode_ == CBC_DECRYPT && pkcs7_) {
+    // the padding is all in the last block, which update() held back
+    const size_t size = out->size() - start;
+    const uint8_t padval = size ? out->back() : 0;
+    if (!padval || padval > size || padval > AES_BLOCKLEN) {
+      out->resize(start);
+      return false;
+    }
+    for (size_t i = out->size() - padval; i < out->size(); i++) {
+      if ((*out)[i] != padval) {
+        out->resize(start);
+        return false;
+      }
+    }
+    out->resize(out->size() - padval);
+  }
+  return true;
+}
+
+bool AesStream::process(std::istream &in, std::ostream &out,
+                        size_t chunk_size) {
+  std::vector<uint8_t> chunk(chunk_size), output;
+  output.reserve(chunk_size + 2 * AES_BLOCKLEN);
+  while (in) {
+    in.read(reinterpret_cast<char *>(chunk.data()), chunk_size);
+    output.clear();
+    update(chunk.data(), in.gcount(), &output);
+    out.write(reinterpret_cast<const char *>(output.data()), output.size());
+  }
+  if (in.bad()) return false;
+
+  output.clear();
+  const bool ok = finish(&output);
+  out.write(reinterpret_cast<const char *>(output.data()), output.size());
+  return ok && out.good();
+}
+
+bool AesStream::process_file(const std::string &in_path,
+                             const std::string &out_path, size_t chunk_size) {
+  std::ifstream in(in_path, std::ios::binary);
+  std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+  if (!in || !out) return false;
+  return process(in, out, chunk_size);
+}
+}  // namespace cryptopals
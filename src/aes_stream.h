@@ -0,0 +1,81 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "./aes.hpp"
+
+namespace cryptopals {
+
+class AesKey;
+
+// AES over input that arrives a chunk at a time, for files too big to hold in
+// memory. The CBC iv or CTR position carries over from one update() to the
+// next, so splitting the input up any which way gives the same output as
+// doing it all at once with Buffer. PKCS#7 padding is only added or stripped
+// by finish().
+class AesStream {
+ public:
+  enum Mode { CBC_ENCRYPT, CBC_DECRYPT, CTR_XCRYPT };
+
+  // For CBC, iv is AES_BLOCKLEN bytes, or empty for all zeros like
+  // Buffer::aes_cbc_encrypt(). CTR uses nonce instead, and never pads.
+  AesStream(std::shared_ptr<const AesKey> key, Mode mode,
+            const std::string &iv = "", uint64_t nonce = 0,
+            bool pkcs7 = true);
+  AesStream(const std::string &key, Mode mode, const std::string &iv = "",
+            uint64_t nonce = 0, bool pkcs7 = true);
+  AesStream(const AesStream &other) = delete;
+
+  // Process size bytes, appending whatever output is ready to out. CBC holds
+  // back a partial block, and when decrypting with padding the last full
+  // block too, until it knows whether more input is coming.
+  void update(const uint8_t *data, size_t size, std::vector<uint8_t> *out);
+
+  // Flush the held back bytes, adding or removing padding. Returns false,
+  // leaving out as it was, if the input ended partway through a block (e.g.
+  // truncated ciphertext) or the padding is bad.
+  bool finish(std::vector<uint8_t> *out);
+
+  // Run all of in through the stream, writing to out as it goes and reading
+  // chunk_size bytes at a time, so memory use doesn't depend on the input
+  // size. Returns false on an I/O error, or if finish() does.
+  bool process(std::istream &in, std::ostream &out,
+               size_t chunk_size = kChunkSize);
+  bool process_file(const std::string &in_path, const std::string &out_path,
+                    size_t chunk_size = kChunkSize);
+
+  static constexpr size_t kChunkSize = 1 << 20;
+
+ private:
+  std::shared_ptr<const AesKey> key_;
+  Mode mode_;
+  bool pkcs7_;
+  uint8_t iv_[AES_BLOCKLEN];
+  uint64_t nonce_;
+  uint64_t offset_;
+  std::vector<uint8_t> pending_;
+};
+}  // namespace cryptopals
@@ -0,0 +1,99 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "aes_ttable.h"
+
+#include <string.h>
+
+uint32_t TTABLE_Te[4][256];
+uint32_t TTABLE_Td[4][256];
+uint8_t TTABLE_Te4[256];
+uint8_t TTABLE_Td4[256];
+
+static uint8_t xtime(uint8_t x) { return (x << 1) ^ (((x >> 7) & 1) * 0x1b); }
+
+static uint8_t mul(uint8_t x, uint8_t y) {
+  uint8_t r = 0;
+  while (y) {
+    if (y & 1) r ^= x;
+    x = xtime(x);
+    y >>= 1;
+  }
+  return r;
+}
+
+static uint32_t word(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  return ((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | d;
+}
+
+static uint32_t ror8(uint32_t x) { return (x >> 8) | (x << 24); }
+
+void TTABLE_init(const uint8_t* sbox, const uint8_t* rsbox) {
+  for (unsigned i = 0; i < 256; i++) {
+    const uint8_t s = sbox[i];
+    const uint8_t r = rsbox[i];
+    TTABLE_Te[0][i] = word(mul(s, 2), s, s, mul(s, 3));
+    TTABLE_Td[0][i] =
+        word(mul(r, 0x0e), mul(r, 0x09), mul(r, 0x0d), mul(r, 0x0b));
+    for (unsigned j = 1; j < 4; j++) {
+      TTABLE_Te[j][i] = ror8(TTABLE_Te[j - 1][i]);
+      TTABLE_Td[j][i] = ror8(TTABLE_Td[j - 1][i]);
+    }
+    TTABLE_Te4[i] = s;
+    TTABLE_Td4[i] = r;
+  }
+}
+
+// InvMixColumns of a single column. Td[Te4[x]] undoes the inverse S-box
+// built into the Td tables.
+static uint32_t inv_mix_column(uint32_t w) {
+  return TTABLE_Td[0][TTABLE_Te4[w >> 24]] ^
+         TTABLE_Td[1][TTABLE_Te4[(w >> 16) & 0xff]] ^
+         TTABLE_Td[2][TTABLE_Te4[(w >> 8) & 0xff]] ^
+         TTABLE_Td[3][TTABLE_Te4[w & 0xff]];
+}
+
+void TTABLE_invert_key(const uint8_t* RoundKey, uint8_t* InvRoundKey,
+                       unsigned rounds) {
+  memcpy(InvRoundKey, RoundKey + rounds * 16, 16);
+  for (unsigned i = 1; i < rounds; i++) {
+    for (unsigned j = 0; j < 4; j++) {
+      const uint32_t w = TTABLE_load32(RoundKey + (rounds - i) * 16 + j * 4);
+      TTABLE_store32(InvRoundKey + i * 16 + j * 4, inv_mix_column(w));
+    }
+  }
+  memcpy(InvRoundKey + rounds * 16, RoundKey, 16);
+}
+
+void TTABLE_encrypt(const uint8_t* RoundKey, unsigned rounds, uint8_t* buf) {
+  uint32_t s[4];
+  TTABLE_load_block(s, buf, RoundKey);
+  for (unsigned round = 1; round < rounds; round++) {
+    TTABLE_enc_round(s, RoundKey + 16 * round);
+  }
+  TTABLE_enc_last(s, RoundKey + 16 * rounds, buf);
+}
+
+void TTABLE_decrypt(const uint8_t* InvRoundKey, unsigned rounds,
+                    uint8_t* buf) {
+  uint32_t s[4];
+  TTABLE_load_block(s, buf, InvRoundKey);
+  for (unsigned round = 1; round < rounds; round++) {
+    TTABLE_dec_round(s, InvRoundKey + 16 * round);
+  }
+  TTABLE_dec_last(s, InvRoundKey + 16 * rounds, buf);
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+// Portable 32-bit T-table AES backend for aes.h and aes_cipher.h.
+// SubBytes, ShiftRows and MixColumns are folded into four 1 KiB tables, so a
+// round is 16 table lookups and some XORs. Decryption uses the "equivalent
+// inverse cipher" schedule, which has the same layout as the AES-NI one.
+//
+// Lookups are indexed by state bytes, so this is *not* constant time.
+
+#ifndef _AES_TTABLE_H_
+#define _AES_TTABLE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// TTABLE_Te[0][x] is the MixColumns column for S[x] in row 0, i.e.
+// (2s, s, s, 3s) from the most significant byte down; TTABLE_Te[1..3] are the
+// same column rotated for rows 1..3. TTABLE_Td is the equivalent for
+// InvMixColumns and the inverse S-box. TTABLE_Te4/TTABLE_Td4 are plain copies
+// of the S-boxes, for the last round and the key schedule.
+extern uint32_t TTABLE_Te[4][256];
+extern uint32_t TTABLE_Td[4][256];
+extern uint8_t TTABLE_Te4[256];
+extern uint8_t TTABLE_Td4[256];
+
+// Build the tables from the S-box and its inverse. Must be called before any
+// of the other functions.
+void TTABLE_init(const uint8_t* sbox, const uint8_t* rsbox);
+
+// Derive the decryption schedule from the encryption schedule.
+void TTABLE_invert_key(const uint8_t* RoundKey, uint8_t* InvRoundKey,
+                       unsigned rounds);
+
+// Encrypt/decrypt a single block in place.
+void TTABLE_encrypt(const uint8_t* RoundKey, unsigned rounds, uint8_t* buf);
+void TTABLE_decrypt(const uint8_t* InvRoundKey, unsigned rounds, uint8_t* buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+// The round functions are inline so that callers who know the number of
+// rounds at compile time can unroll them. The state is four big-endian column
+// words, and rk points at the round key for this round.
+
+static inline uint32_t TTABLE_load32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void TTABLE_store32(uint8_t* p, uint32_t x) {
+  p[0] = (uint8_t)(x >> 24);
+  p[1] = (uint8_t)(x >> 16);
+  p[2] = (uint8_t)(x >> 8);
+  p[3] = (uint8_t)x;
+}
+
+static inline void TTABLE_load_block(uint32_t s[4], const uint8_t* buf,
+                                     const uint8_t* rk) {
+  for (unsigned i = 0; i < 4; i++) {
+    s[i] = TTABLE_load32(buf + 4 * i) ^ TTABLE_load32(rk + 4 * i);
+  }
+}
+
+static inline void TTABLE_enc_round(uint32_t s[4], const uint8_t* rk) {
+  uint32_t t[4];
+  for (unsigned i = 0; i < 4; i++) {
+    t[i] = TTABLE_Te[0][s[i] >> 24] ^
+           TTABLE_Te[1][(s[(i + 1) & 3] >> 16) & 0xff] ^
+           TTABLE_Te[2][(s[(i + 2) & 3] >> 8) & 0xff] ^
+           TTABLE_Te[3][s[(i + 3) & 3] & 0xff] ^ TTABLE_load32(rk + 4 * i);
+  }
+  for (unsigned i = 0; i < 4; i++) {
+    s[i] = t[i];
+  }
+}
+
+// The last round has no MixColumns, and writes the result to buf.
+static inline void TTABLE_enc_last(const uint32_t s[4], const uint8_t* rk,
+                                   uint8_t* buf) {
+  for (unsigned i = 0; i < 4; i++) {
+    const uint32_t t =
+        ((uint32_t)TTABLE_Te4[s[i] >> 24] << 24) |
+        ((uint32_t)TTABLE_Te4[(s[(i + 1) & 3] >> 16) & 0xff] << 16) |
+        ((uint32_t)TTABLE_Te4[(s[(i + 2) & 3] >> 8) & 0xff] << 8) |
+        TTABLE_Te4[s[(i + 3) & 3] & 0xff];
+    TTABLE_store32(buf + 4 * i, t ^ TTABLE_load32(rk + 4 * i));
+  }
+}
+
+static inline void TTABLE_dec_round(uint32_t s[4], const uint8_t* rk) {
+  uint32_t t[4];
+  for (unsigned i = 0; i < 4; i++) {
+    t[i] = TTABLE_Td[0][s[i] >> 24] ^
+           TTABLE_Td[1][(s[(i + 3) & 3] >> 16) & 0xff] ^
+           TTABLE_Td[2][(s[(i + 2) & 3] >> 8) & 0xff] ^
+           TTABLE_Td[3][s[(i + 1) & 3] & 0xff] ^ TTABLE_load32(rk + 4 * i);
+  }
+  for (unsigned i = 0; i < 4; i++) {
+    s[i] = t[i];
+  }
+}
+
+static inline void TTABLE_dec_last(const uint32_t s[4], const uint8_t* rk,
+                                   uint8_t* buf) {
+  for (unsigned i = 0; i < 4; i++) {
+    const uint32_t t =
+        ((uint32_t)TTABLE_Td4[s[i] >> 24] << 24) |
+        ((uint32_t)TTABLE_Td4[(s[(i + 3) & 3] >> 16) & 0xff] << 16) |
+        ((uint32_t)TTABLE_Td4[(s[(i + 2) & 3] >> 8) & 0xff] << 8) |
+        TTABLE_Td4[s[(i + 1) & 3] & 0xff];
+    TTABLE_store32(buf + 4 * i, t ^ TTABLE_load32(rk + 4 * i));
+  }
+}
+
+#endif  //_AES_TTABLE_H_
@@ -0,0 +1,54 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "./arena.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace cryptopals {
+
+Arena::Arena(size_t block_size)
+    : block_size_(block_size), capacity_(0), current_(0), used_(0) {}
+
+void *Arena::allocate(size_t bytes, size_t align) {
+  assert(align && (align & (align - 1)) == 0);
+  for (; current_ < blocks_.size(); current_++, used_ = 0) {
+    Block &block = blocks_[current_];
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    const uintptr_t start = (base + used_ + align - 1) & ~(align - 1);
+    if (start + bytes <= base + block.size) {
+      used_ = start + bytes - base;
+      return reinterpret_cast<void *>(start);
+    }
+  }
+
+  // Nothing left fits, so add a block. Oversized requests get a block of
+  // their own.
+  const size_t size = std::max(block_size_, bytes + align);
+  blocks_.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[size]), size});
+  capacity_ += size;
+  current_ = blocks_.size() - 1;
+  used_ = 0;
+  return allocate(bytes, align);
+}
+
+void Arena::reset() {
+  current_ = 0;
+  used_ = 0;
+}
+}  // namespace cryptopals
@@ -0,0 +1,89 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cryptopals {
+
+// A bump allocator for short-lived scratch data, like the maps built for each
+// candidate in a key search. Allocation is a pointer increment, individual
+// frees do nothing, and reset() releases everything at once while keeping
+// the memory around for the next round.
+class Arena {
+ public:
+  explicit Arena(size_t block_size = kBlockSize);
+  Arena(const Arena &other) = delete;
+
+  void *allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+  // Forget everything allocated so far. The blocks are kept and reused.
+  void reset();
+
+  // total size of the blocks owned by the arena
+  inline size_t capacity() const { return capacity_; }
+
+  static constexpr size_t kBlockSize = 16 << 10;
+
+ private:
+  struct Block {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size;
+  };
+
+  size_t block_size_;
+  size_t capacity_;
+  std::vector<Block> blocks_;
+  size_t current_;  // index into blocks_
+  size_t used_;     // bytes used in the current block
+};
+
+// A standard allocator on top of an Arena, for containers that only live as
+// long as one search.
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(Arena *arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena()) {}
+
+  inline T *allocate(size_t n) {
+    return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+  inline void deallocate(T *, size_t) {}
+
+  inline Arena *arena() const { return arena_; }
+
+  template <typename U>
+  inline bool operator==(const ArenaAllocator<U> &other) const {
+    return arena_ == other.arena();
+  }
+  template <typename U>
+  inline bool operator!=(const ArenaAllocator<U> &other) const {
+    return arena_ != other.arena();
+  }
+
+ private:
+  Arena *arena_;
+};
+}  // namespace cryptopals
@@ -0,0 +1,409 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "base64.h"
+
+#include <string.h>
+
+#include "cpu.h"
+
+static const char base64_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 6-bit value of each character, or -1 (which includes '=')
+static int8_t base64_values[256];
+
+static void encode_scalar(const uint8_t* in, size_t len, char* out) {
+  size_t i = 0;
+  for (; i + 3 <= len; i += 3, out += 4) {
+    const uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    out[0] = base64_chars[v >> 18];
+    out[1] = base64_chars[(v >> 12) & 0x3f];
+    out[2] = base64_chars[(v >> 6) & 0x3f];
+    out[3] = base64_chars[v & 0x3f];
+  }
+  if (i == len) {
+    return;
+  }
+  const uint8_t b = i + 1 < len ? in[i + 1] : 0;
+  out[0] = base64_chars[in[i] >> 2];
+  out[1] = base64_chars[((in[i] & 0x3) << 4) | (b >> 4)];
+  out[2] = i + 1 < len ? base64_chars[(b & 0xf) << 2] : '=';
+  out[3] = '=';
+}
+
+static int decode_scalar(const char* in, size_t len, uint8_t* out,
+                         size_t* out_len) {
+  *out_len = 0;
+  if (len % 4) {
+    return 0;
+  }
+  if (len == 0) {
+    return 1;
+  }
+  const size_t padding = in[len - 1] == '=' ? (in[len - 2] == '=' ? 2 : 1) : 0;
+
+  // every group but the last is always four characters of data
+  int8_t bad = 0;
+  const size_t groups = padding ? len / 4 - 1 : len / 4;
+  for (size_t i = 0; i < groups; i++, in += 4, out += 3) {
+    const int8_t a = base64_values[(uint8_t)in[0]];
+    const int8_t b = base64_values[(uint8_t)in[1]];
+    const int8_t c = base64_values[(uint8_t)in[2]];
+    const int8_t d = base64_values[(uint8_t)in[3]];
+    bad |= a | b | c | d;
+    const uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) |
+                       ((uint32_t)c << 6) | (uint32_t)(d & 0x3f);
+    out[0] = (uint8_t)(v >> 16);
+    out[1] = (uint8_t)(v >> 8);
+    out[2] = (uint8_t)v;
+  }
+  *out_len = groups * 3;
+  if (padding) {
+    const int8_t a = base64_values[(uint8_t)in[0]];
+    const int8_t b = base64_values[(uint8_t)in[1]];
+    const int8_t c = padding == 1 ? base64_values[(uint8_t)in[2]] : 0;
+    bad |= a | b | c;
+    out[0] = (uint8_t)(((uint8_t)a << 2) | ((b & 0x3f) >> 4));
+    if (padding == 1) {
+      out[1] = (uint8_t)(((uint8_t)b << 4) | ((c & 0x3f) >> 2));
+    }
+    *out_len += 3 - padding;
+  }
+  return bad >= 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+// The vector kernels follow Muła and Lemire, "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions". Each 32-bit lane holds one group of
+// three bytes or four characters.
+
+// Spread the first 12 bytes of v into 16 6-bit values.
+SSSE3_TARGET static inline __m128i unpack_ssse3(__m128i v) {
+  v = _mm_shuffle_epi8(
+      v, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  // shift each 6-bit field into its own byte: a and c with a high multiply,
+  // b and d with a low one
+  const __m128i ac =
+      _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)),
+                      _mm_set1_epi32(0x04000040));
+  const __m128i bd =
+      _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)),
+                      _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(ac, bd);
+}
+
+// Map 6-bit values to the alphabet by adding an offset that depends on which
+// of the five ranges (A-Z, a-z, 0-9, +, /) each value falls in.
+SSSE3_TARGET static inline __m128i to_chars_ssse3(__m128i v) {
+  const __m128i offsets =
+      _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  // 52-63 become 1-12, 0-25 become 13 and 26-51 become 0
+  __m128i range = _mm_subs_epu8(v, _mm_set1_epi8(51));
+  const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), v);
+  range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  return _mm_add_epi8(v, _mm_shuffle_epi8(offsets, range));
+}
+
+SSSE3_TARGET static void encode_ssse3(const uint8_t* in, size_t len,
+                                      char* out) {
+  // each step uses 12 bytes but loads 16
+  size_t i = 0;
+  for (; i + 16 <= len; i += 12, out += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+    _mm_storeu_si128((__m128i*)out, to_chars_ssse3(unpack_ssse3(v)));
+  }
+  encode_scalar(in + i, len - i, out);
+}
+
+// Turn 16 characters into their 6-bit values, or'ing a nonzero byte into
+// *bad for any that aren't in the alphabet. The character's high nibble
+// picks one bit and its low nibble a set of allowed bits; they only meet
+// for valid characters.
+SSSE3_TARGET static inline __m128i from_chars_ssse3(__m128i v, __m128i* bad) {
+  const __m128i lo_lut =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i hi_lut =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i offsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0,
+                                        0, 0, 0, 0, 0, 0, 0);
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i hi =
+      _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi8(0x0f));
+  const __m128i lo = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+  *bad = _mm_or_si128(*bad, _mm_and_si128(_mm_shuffle_epi8(lo_lut, lo),
+                                          _mm_shuffle_epi8(hi_lut, hi)));
+  // '/' shares its high nibble with '+' but needs its own offset
+  const __m128i range = _mm_add_epi8(_mm_cmpeq_epi8(v, slash), hi);
+  return _mm_add_epi8(v, _mm_shuffle_epi8(offsets, range));
+}
+
+// Pack 16 6-bit values into the low 12 bytes.
+SSSE3_TARGET static inline __m128i pack_ssse3(__m128i v) {
+  const __m128i pairs = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+  const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(
+      groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                            -1, -1));
+}
+
+SSSE3_TARGET static int decode_ssse3(const char* in, size_t len, uint8_t* out,
+                                     size_t* out_len) {
+  // Each step stores 16 bytes but only produces 12, so leave at least two
+  // more groups to overwrite the extra; that also keeps padding out of the
+  // vector loop.
+  __m128i bad = _mm_setzero_si128();
+  size_t i = 0;
+  for (; len % 4 == 0 && i + 24 <= len; i += 16, out += 12) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+    _mm_storeu_si128((__m128i*)out, pack_ssse3(from_chars_ssse3(v, &bad)));
+  }
+  const int ok = _mm_movemask_epi8(
+      _mm_cmpeq_epi8(bad, _mm_setzero_si128())) == 0xffff;
+  const int tail_ok = decode_scalar(in + i, len - i, out, out_len);
+  *out_len += i / 4 * 3;
+  return ok && tail_ok;
+}
+
+AVX2_TARGET static void encode_avx2(const uint8_t* in, size_t len, char* out) {
+  const __m256i offsets = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  const __m256i spread = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  // each step uses 24 bytes, 12 from each of two overlapping 16 byte loads
+  size_t i = 0;
+  for (; i + 28 <= len; i += 24, out += 32) {
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in + i))),
+        _mm_loadu_si128((const __m128i*)(in + i + 12)), 1);
+    v = _mm256_shuffle_epi8(v, spread);
+    const __m256i ac = _mm256_mulhi_epu16(
+        _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)),
+        _mm256_set1_epi32(0x04000040));
+    const __m256i bd = _mm256_mullo_epi16(
+        _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)),
+        _mm256_set1_epi32(0x01000010));
+    v = _mm256_or_si256(ac, bd);
+
+    __m256i range = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+    const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), v);
+    range = _mm256_or_si256(range,
+                            _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    v = _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, range));
+    _mm256_storeu_si256((__m256i*)out, v);
+  }
+  encode_ssse3(in + i, len - i, out);
+}
+
+AVX2_TARGET static int decode_avx2(const char* in, size_t len, uint8_t* out,
+                                   size_t* out_len) {
+  const __m256i lo_lut = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a,
+      0x1b, 0x1b, 0x1b, 0x1a, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i hi_lut = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i offsets = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  // as in decode_ssse3, but a step stores 8 bytes more than it produces
+  __m256i bad = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; len % 4 == 0 && i + 48 <= len; i += 32, out += 24) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), nibble);
+    const __m256i lo = _mm256_and_si256(v, nibble);
+    bad = _mm256_or_si256(bad,
+                          _mm256_and_si256(_mm256_shuffle_epi8(lo_lut, lo),
+                                           _mm256_shuffle_epi8(hi_lut, hi)));
+    const __m256i range = _mm256_add_epi8(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')), hi);
+    v = _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, range));
+
+    v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+    v = _mm256_shuffle_epi8(v, pack);
+    // each lane has 12 bytes at the bottom; close the gap between them
+    v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7,
+                                                         7));
+    _mm256_storeu_si256((__m256i*)out, v);
+  }
+  const int ok = _mm256_testz_si256(bad, bad);
+  const int tail_ok = decode_ssse3(in + i, len - i, out, out_len);
+  *out_len += i / 4 * 3;
+  return ok && tail_ok;
+}
+
+#endif
+
+static const unsigned impl_features[] = {0, CPU_SSSE3, CPU_AVX2};
+
+static enum BASE64_impl impl;
+static void (*encode)(const uint8_t* in, size_t len, char* out);
+static int (*decode)(const char* in, size_t len, uint8_t* out,
+                     size_t* out_len);
+
+static void use_impl(enum BASE64_impl i) {
+  impl = i;
+  switch (i) {
+#if defined(__x86_64__) || defined(__i386__)
+    case BASE64_IMPL_AVX2:
+      encode = encode_avx2;
+      decode = decode_avx2;
+      break;
+    case BASE64_IMPL_SSSE3:
+      encode = encode_ssse3;
+      decode = decode_ssse3;
+      break;
+#endif
+    default:
+      encode = encode_scalar;
+      decode = decode_scalar;
+      break;
+  }
+}
+
+static void bind(void) {
+  enum BASE64_impl best = BASE64_IMPL_SCALAR;
+  if (CPU_has(CPU_AVX2)) {
+    best = BASE64_IMPL_AVX2;
+  } else if (CPU_has(CPU_SSSE3)) {
+    best = BASE64_IMPL_SSSE3;
+  }
+  use_impl(best);
+}
+
+__attribute__((constructor)) static void Init(void) {
+  for (int i = 0; i < 256; i++) {
+    base64_values[i] = -1;
+  }
+  for (int i = 0; i < 64; i++) {
+    base64_values[(uint8_t)base64_chars[i]] = (int8_t)i;
+  }
+  CPU_register(bind);
+}
+
+enum BASE64_impl BASE64_get_impl(void) {
+  return impl;
+}
+
+int BASE64_set_impl(enum BASE64_impl i) {
+  if (!CPU_has(impl_features[i])) {
+    return 0;
+  }
+  use_impl(i);
+  return 1;
+}
+
+void BASE64_encode(const uint8_t* in, size_t len, char* out) {
+  encode(in, len, out);
+}
+
+int BASE64_decode(const char* in, size_t len, uint8_t* out, size_t* out_len) {
+  return decode(in, len, out, out_len);
+}
+
+// The decoder compacts line breaks out of its input into blocks of this many
+// characters, small enough to stay in L1, and hands each block to the bulk
+// decoder.
+#define DECODER_BLOCK 4096
+
+// Decode the whole groups at the start of block, and move what's left to
+// the front.
+static void decoder_flush(struct BASE64_decoder* ctx, char* block, size_t* n,
+                          uint8_t* out, size_t* out_len) {
+  const size_t whole = *n & ~(size_t)3;
+  if (whole == 0) {
+    return;
+  }
+  size_t size;
+  if (ctx->padded || !BASE64_decode(block, whole, out + *out_len, &size)) {
+    ctx->error = 1;
+  } else {
+    ctx->padded = size < whole / 4 * 3;
+    *out_len += size;
+  }
+  memmove(block, block + whole, *n - whole);
+  *n -= whole;
+}
+
+void BASE64_decoder_init(struct BASE64_decoder* ctx) {
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+int BASE64_decoder_update(struct BASE64_decoder* ctx, const char* in,
+                          size_t len, uint8_t* out, size_t* out_len) {
+  char block[DECODER_BLOCK];
+  size_t n = ctx->npending;
+  memcpy(block, ctx->pending, n);
+  *out_len = 0;
+
+  const char* end = in + len;
+  while (in < end && !ctx->error) {
+    // copy up to the next line break, skipping the break itself
+    const char* stop = memchr(in, '\n', end - in);
+    if (stop == NULL) {
+      stop = end;
+    }
+    const char* cr = memchr(in, '\r', stop - in);
+    if (cr != NULL) {
+      stop = cr;
+    }
+    size_t run = stop - in;
+    if (run > DECODER_BLOCK - n) {
+      run = DECODER_BLOCK - n;
+    }
+    memcpy(block + n, in, run);
+    n += run;
+    in += run;
+    if (in == stop && in < end) {
+      in++;
+    }
+    if (n == DECODER_BLOCK) {
+      decoder_flush(ctx, block, &n, out, out_len);
+    }
+  }
+  decoder_flush(ctx, block, &n, out, out_len);
+
+  memcpy(ctx->pending, block, n);
+  ctx->npending = n;
+  return !ctx->error;
+}
+
+int BASE64_decoder_finish(const struct BASE64_decoder* ctx) {
+  return !ctx->error && ctx->npending == 0;
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+// Base64 encoding and decoding with the standard alphabet and '=' padding.
+// Decoding checks every character, including where padding appears. Bulk
+// input goes through AVX2 or SSSE3 kernels when the CPU has them, with a
+// table driven scalar version for the tail and for other CPUs.
+
+#ifndef _BASE64_H_
+#define _BASE64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The encoded size of len bytes, padding included.
+#define BASE64_ENCODED_LEN(len) (((len) + 2) / 3 * 4)
+
+// An upper bound on the decoded size of len characters.
+#define BASE64_DECODED_MAX(len) ((len) / 4 * 3)
+
+enum BASE64_impl {
+  BASE64_IMPL_SCALAR = 0,
+  BASE64_IMPL_SSSE3 = 1,
+  BASE64_IMPL_AVX2 = 2,
+};
+
+// The best implementation the CPU tier allows is picked at startup, and
+// again whenever the tier changes (see cpu.h).
+enum BASE64_impl BASE64_get_impl(void);
+
+// Force a particular implementation, e.g. to test them against each other.
+// Returns 0 (and changes nothing) if the CPU tier doesn't allow it.
+int BASE64_set_impl(enum BASE64_impl impl);
+
+// Write the BASE64_ENCODED_LEN(len) characters for in to out. No terminator
+// is added.
+void BASE64_encode(const uint8_t* in, size_t len, char* out);
+
+// Decode len characters from in to out, which must have room for
+// BASE64_DECODED_MAX(len) bytes, and store the decoded size in *out_len.
+// Returns 0 if len isn't a multiple of 4, a character is outside the
+// alphabet, or padding appears anywhere but the end; otherwise returns 1.
+int BASE64_decode(const char* in, size_t len, uint8_t* out, size_t* out_len);
+
+// Incremental decoding, for input that arrives in chunks split anywhere
+// (even inside a group) or is too big to hold at once. Line breaks ('\n' and
+// '\r') are skipped, so wrapped base64 can be fed in as is.
+struct BASE64_decoder {
+  char pending[4];  // a partial group carried over to the next update
+  size_t npending;
+  int padded;       // a group with padding has been decoded
+  int error;
+};
+
+void BASE64_decoder_init(struct BASE64_decoder* ctx);
+
+// Decode the next len characters to out, which must have room for
+// BASE64_DECODED_MAX(len + 3) bytes, and store the number of bytes written in
+// *out_len. Returns 0 once the input is known to be invalid, including any
+// data after padding.
+int BASE64_decoder_update(struct BASE64_decoder* ctx, const char* in,
+                          size_t len, uint8_t* out, size_t* out_len);
+
+// Returns 1 if all the input was valid and ended on a whole group.
+int BASE64_decoder_finish(const struct BASE64_decoder* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_BASE64_H_
@@ -0,0 +1,229 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "./bench.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "./aes.hpp"
+#include "./aes_cipher.h"
+#include "./buffer.h"
+#include "./cpu.h"
+#include "./ghash.h"
+#include "./histogram.h"
+#include "./util.h"
+#include "./words.h"
+
+namespace cryptopals {
+
+static const size_t bench_bytes = 16 << 20;
+static const size_t storage_bench_bytes = 256 << 20;
+static const int bench_rounds = 4;
+static const int storage_bench_rounds = 8;
+
+// Counts data TLB misses in the calling thread, if the kernel allows perf
+// events.
+class TlbMissCounter {
+ public:
+  TlbMissCounter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+  TlbMissCounter(const TlbMissCounter &other) = delete;
+  ~TlbMissCounter() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  inline bool ok() const { return fd_ >= 0; }
+
+  void start() {
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  uint64_t stop() {
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t count = 0;
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) return 0;
+    return count;
+  }
+
+ private:
+  int fd_;
+};
+
+static const char *backend_name(AES_backend backend) {
+  switch (backend) {
+    case AES_BACKEND_TTABLE:
+      return "T-table";
+    case AES_BACKEND_AESNI:
+      return "AES-NI";
+  }
+  return "unknown";
+}
+
+// Run f on a fresh buffer bench_rounds times, and print the best MB/s.
+static void bench(const std::string &name,
+                  const std::function<void(Buffer *)> &f) {
+  const Buffer plaintext(rand_string(bench_bytes));
+  double best = 0;
+  for (int i = 0; i < bench_rounds; i++) {
+    Buffer buf = plaintext;
+    const auto start = std::chrono::steady_clock::now();
+    f(&buf);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::max(best, bench_bytes / elapsed.count() / 1e6);
+  }
+  std::cout << std::left << std::setw(16) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1) << best
+            << " MB/s\n";
+}
+
+// ECB over one very large buffer with the given storage, printing MB/s and
+// TLB misses per MiB. This runs on one thread so the counter sees all of it.
+static void bench_storage(const std::string &name, StoragePolicy policy,
+                          const AesKey &key) {
+  // constructing with the policy sizes the storage once and touches every
+  // page, and an untimed pass settles whatever faults are left (e.g. the
+  // kernel collapsing transparent huge pages) before the timed ones
+  Buffer buf(std::string(storage_bench_bytes, 'x'), STRING, policy);
+  buf.aes_ecb_encrypt(key, false);
+  TlbMissCounter tlb;
+  double best = 0;
+  uint64_t misses = std::numeric_limits<uint64_t>::max();
+  for (int i = 0; i < storage_bench_rounds; i++) {
+    if (tlb.ok()) tlb.start();
+    const auto start = std::chrono::steady_clock::now();
+    buf.aes_ecb_encrypt(key, false);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (tlb.ok()) misses = std::min(misses, tlb.stop());
+    best = std::max(best, storage_bench_bytes / elapsed.count() / 1e6);
+  }
+
+  std::cout << std::left << std::setw(16) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1) << best
+            << " MB/s";
+  if (tlb.ok()) {
+    std::cout << std::setw(12)
+              << static_cast<double>(misses) / (storage_bench_bytes >> 20)
+              << " dTLB misses/MiB";
+  } else {
+    std::cout << "  (dTLB misses unavailable: no perf events)";
+  }
+  std::cout << "\n";
+}
+
+int RunBenchmarks() {
+  std::cout << "CPU tier: " << CPU_tier_name(CPU_get_tier()) << ", ";
+  std::cout << "AES backend: " << backend_name(AES_get_backend())
+            << ", GHASH: "
+            << (GHASH_clmul_supported() ? "PCLMULQDQ" : "4-bit tables")
+            << ", histogram: "
+            << (HIST_get_impl() == HIST_IMPL_UNROLLED ? "8 tables" : "4 tables")
+            << "\n";
+
+  // the codecs are measured by the size of the binary side
+  const Buffer binary(rand_string(bench_bytes));
+  const std::string hex = binary.encode_hex();
+  const std::string base64 = binary.encode_base64();
+  bench("hex encode", [](Buffer *buf) { buf->encode_hex(); });
+  bench("hex decode", [&](Buffer *) { Buffer decoded(hex, HEX); });
+  bench("base64 encode", [](Buffer *buf) { buf->encode_base64(); });
+  bench("base64 decode", [&](Buffer *) { Buffer decoded(base64, BASE64); });
+
+  const std::string xor_key = rand_string(29);
+  bench("xor byte", [](Buffer *buf) { buf->xor_byte(0x5a); });
+  bench("xor string", [&](Buffer *buf) { buf->xor_string(xor_key); });
+  bench("histogram", [](Buffer *buf) {
+    size_t counts[256];
+    HIST_count(buf->view().data(), buf->size(), counts);
+  });
+
+  // scored a line at a time, like the candidates of a key search
+  bench("score text", [](Buffer *buf) {
+    const std::string_view text = buf->view().str();
+    for (size_t i = 0; i + 64 <= text.size(); i += 64) {
+      score_text(text.substr(i, 64), false);
+    }
+  });
+
+  // and loading it back from a file wrapped like the challenge data
+  char path[] = "/tmp/cryptopals-bench-XXXXXX";
+  const int fd = mkstemp(path);
+  if (fd != -1) {
+    close(fd);
+    std::ofstream file(path);
+    for (size_t i = 0; i < base64.size(); i += 60) {
+      file << base64.substr(i, 60) << '\n';
+    }
+    file.close();
+    bench("base64 file", [&](Buffer *) { Buffer loaded(path, BASE64_FILE); });
+    unlink(path);
+  }
+
+  for (size_t key_size : {16, 32}) {
+    const AesKey key(rand_string(key_size));
+    const Buffer iv(rand_string(12));
+    const std::string bits = std::to_string(key_size * 8);
+    // bench_bytes is whole blocks, so skip the padding and the reallocation
+    // it would cost
+    bench("ECB-" + bits,
+          [&](Buffer *buf) { buf->aes_ecb_encrypt(key, false); });
+    bench("CBC-" + bits,
+          [&](Buffer *buf) { buf->aes_cbc_encrypt(key, false); });
+    bench("CBC-" + bits + " dec",
+          [&](Buffer *buf) { buf->aes_cbc_decrypt(key, false); });
+    bench("CTR-" + bits, [&](Buffer *buf) { buf->aes_ctr_xcrypt(key, 0); });
+    bench("GCM-" + bits, [&](Buffer *buf) { buf->aes_gcm_encrypt(key, iv); });
+  }
+
+  std::cout << "ECB-128 over " << (storage_bench_bytes >> 20)
+            << " MiB, one thread:\n";
+  const size_t threshold = Buffer::parallel_threshold();
+  Buffer::set_parallel_threshold(std::numeric_limits<size_t>::max());
+  const AesKey key(rand_key());
+  bench_storage("4 KiB pages", HEAP_STORAGE, key);
+  bench_storage("huge pages", HUGE_PAGE_STORAGE, key);
+  Buffer::set_parallel_threshold(threshold);
+  return 0;
+}
+}  // namespace cryptopals
@@ -17,121 +17,82 @@
 #include "./buffer.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstring>
-#include <fstream>
 #include <iostream>
 #include <limits>
+#include <optional>
 #include <random>
-#include <sstream>
 #include <unordered_map>
+#include <utility>
 
-#include "./aes.hpp"
+#include "./aes_cipher.h"
+#include "./aes_modes.h"
+#include "./arena.h"
+#include "./base64.h"
 #include "./counter.h"
+#include "./ghash.h"
+#include "./hex.h"
+#include "./histogram.h"
+#include "./mapped_file.h"
+#include "./thread_pool.h"
 #include "./util.h"
 #include "./words.h"
+#include "./xor.h"
 
 namespace cryptopals {
 
-Buffer Buffer::slice(size_t start, size_t end) const {
-  end = std::min(end, buf_.size());
-  return Buffer(
-      std::vector<uint8_t>(buf_.cbegin() + start, buf_.cbegin() + end));
+bool BufferView::operator==(BufferView other) const {
+  return size_ == other.size_ &&
+         (size_ == 0 || std::memcmp(data_, other.data_, size_) == 0);
 }
 
-static const std::string b64_lut =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-// convert a 3 byte string to a 4 byte base64
-inline void bin_to_b64(std::ostringstream &os, uint8_t *inp) {
-  const uint8_t b1 = inp[0] >> 2;
-  assert(b1 < 64);
-  const uint8_t b2 = ((inp[0] & 0x3) << 4) + (inp[1] >> 4);
-  assert(b2 < 64);
-  const uint8_t b3 = ((inp[1] & 0xf) << 2) + (inp[2] >> 6);
-  assert(b3 < 64);
-  const uint8_t b4 = inp[2] & 0x3f;
-  assert(b4 < 64);
-  os << b64_lut[b1] << b64_lut[b2] << b64_lut[b3] << b64_lut[b4];
-}
-
-inline uint8_t b64_char_to_num(char c) {
-  size_t pos = b64_lut.find(c);
-  if (pos == std::string::npos) {
-    return 0;
-  }
-  assert(pos < 64);
-  return static_cast<uint8_t>(pos);
-}
-
-inline void b64_to_bin(std::vector<uint8_t> &out, const char *data) {
-  size_t padding = 0;
-  for (int i = 0; i < 4; i++) {
-    if (data[i] == '=') {
-      padding++;
-    }
-  }
-  assert(padding <= 2);
-
-  uint8_t a = b64_char_to_num(data[0]);
-  uint8_t b = b64_char_to_num(data[1]);
-
-  out.push_back((a << 2) + ((b & 0x30) >> 4));
-  if (padding == 2) {
-    return;
-  }
-  uint8_t c = b64_char_to_num(data[2]);
-  out.push_back(((b & 0xf) << 4) + (c >> 2));
-
-  if (padding == 1) {
-    return;
-  }
-  uint8_t d = b64_char_to_num(data[3]);
-  out.push_back(((c & 0x3) << 6) + d);
-}
-
-// another helper
-inline uint8_t hex_to_bin(const char *str) {
-  assert(isxdigit(str[0]) && isxdigit(str[1]));
-  uint8_t result = (isdigit(str[0]) ? str[0] - '0' : 10 + str[0] - 'a') << 4;
-  result += isdigit(str[1]) ? str[1] - '0' : 10 + str[1] - 'a';
-  return result;
+BufferView BufferView::slice(size_t start, size_t end) const {
+  end = std::min(end, size_);
+  assert(start <= end);
+  return {data_ + start, end - start};
 }
 
-// encode a value in the range 0-f
-inline char bin_to_hex(uint8_t val) {
-  assert(val <= 0xf);
-  if (val < 0xa) {
-    return '0' + val;
-  }
-  return 'a' + val - 0xa;
-}
-
-Buffer::Buffer(const std::string &s, Encoding encoding) {
+Buffer::Buffer(const std::string &s, Encoding encoding,
+               StoragePolicy policy) {
   switch (encoding) {
     case STRING:
+      reserve(s.size(), policy);
       for (char c : s) {
         buf_.push_back(static_cast<uint8_t>(c));
       }
       break;
     case HEX:
       assert(s.size() % 2 == 0);
-      for (size_t i = 0; i < s.size() / 2; i++) {
-        buf_.push_back(hex_to_bin(s.data() + i * 2));
+      reserve(s.size() / 2, policy);
+      buf_.resize_uninitialized(s.size() / 2);
+      if (!HEX_decode(s.data(), s.size(), buf_.data())) {
+        assert(false);  // not a hex string
       }
       break;
     case BASE64:
+      reserve(BASE64_DECODED_MAX(s.size()), policy);
       set_base64_data(s);
       break;
     case BASE64_FILE: {
-      std::ifstream infile(s);
-      std::string line;
-      std::ostringstream os;
-      while (std::getline(infile, line)) {
-        os << line;
-      };
-      set_base64_data(os.str());
+      // Decode straight out of the page cache. The file size counts line
+      // breaks too, so this overestimates a little.
+      const MappedFile file(s);
+      const size_t max_size = BASE64_DECODED_MAX(file.size() + 3);
+      reserve(max_size, policy);
+      buf_.resize_uninitialized(max_size);
+      BASE64_decoder decoder;
+      BASE64_decoder_init(&decoder);
+      size_t size;
+      if (!BASE64_decoder_update(&decoder, file.data(), file.size(),
+                                 buf_.data(), &size) ||
+          !BASE64_decoder_finish(&decoder)) {
+        assert(false);  // not valid base64
+      }
+      buf_.resize(size);
       break;
     }
     default:
@@ -141,100 +102,123 @@ Buffer::Buffer(const std::string &s, Encoding encoding) {
 }
 
 void Buffer::set_base64_data(const std::string &s) {
-  assert(s.size() % 4 == 0);
-  for (size_t i = 0; i < s.size() / 4; i++) {
-    b64_to_bin(buf_, s.data() + i * 4);
+  buf_.resize_uninitialized(BASE64_DECODED_MAX(s.size()));
+  size_t size;
+  if (!BASE64_decode(s.data(), s.size(), buf_.data(), &size)) {
+    assert(false);  // not valid base64
   }
+  buf_.resize(size);
 }
 
-std::string Buffer::encode_hex() const {
-  std::ostringstream os;
-  for (uint8_t c : buf_) {
-    os << bin_to_hex((c & 0xf0) >> 4) << bin_to_hex(c & 0xf);
-  }
-  return os.str();
+std::string BufferView::encode_hex() const {
+  std::string out;
+  encode_hex_into(&out);
+  return out;
 }
 
-std::string Buffer::encode_base64() const {
-  // Kind of annoying, we need to pad the buffer if sz is not divisible by
-  // three.
-  size_t sz = buf_.size();
-  size_t padding = sz % 3;
-  if (padding) {
-    padding = 3 - padding;
-  }
-  sz += padding;
-  std::unique_ptr<uint8_t[]> bytes(new uint8_t[sz]);
-  std::memset(bytes.get(), 0, sz);
-  std::memmove(bytes.get(), buf_.data(), sz);
-
-  std::ostringstream os;
-  for (size_t i = 0; i < sz; i += 3) {
-    bin_to_b64(os, bytes.get() + i);
-  }
-  std::string ret = os.str();
-  assert(ret.size() % 4 == 0);
-  for (size_t i = 0; i < padding; i++) {
-    ret[ret.size() - 1 - i] = '=';
-  }
-  return ret;
+void BufferView::encode_hex_into(std::string *out) const {
+  out->resize(2 * size_);
+  HEX_encode(data_, size_, out->data());
 }
 
-float Buffer::string_score() const { return score_text(encode()); }
+std::string BufferView::encode_base64() const {
+  std::string out(BASE64_ENCODED_LEN(size_), '\0');
+  BASE64_encode(data_, size_, out.data());
+  return out;
+}
+
+float BufferView::string_score() const {
+  return score_text(str());
+}
 
 void Buffer::xor_byte(uint8_t k) {
-  for (size_t i = 0; i < buf_.size(); i++) {
-    buf_[i] ^= k;
-  }
+  XOR_repeating(buf_.data(), buf_.size(), &k, 1, buf_.data());
 }
 
 void Buffer::xor_string(const std::string &key) {
   assert(key.size());
-  for (size_t i = 0; i < buf_.size(); i++) {
-    buf_[i] ^= static_cast<uint8_t>(key[i % key.size()]);
-  }
+  XOR_repeating(buf_.data(), buf_.size(),
+                reinterpret_cast<const uint8_t *>(key.data()), key.size(),
+                buf_.data());
 };
 
-float Buffer::try_single_byte_xor_key(uint8_t key) const {
-  Buffer copy = *this;
-  copy.xor_byte(key);
-  return copy.string_score();
+void Buffer::xor_byte_into(uint8_t k, Buffer *dst) const {
+  dst->buf_.resize_uninitialized(buf_.size());
+  XOR_repeating(buf_.data(), buf_.size(), &k, 1, dst->buf_.data());
+}
+
+void Buffer::xor_string_into(const std::string &key, Buffer *dst) const {
+  assert(key.size());
+  dst->buf_.resize_uninitialized(buf_.size());
+  XOR_repeating(buf_.data(), buf_.size(),
+                reinterpret_cast<const uint8_t *>(key.data()), key.size(),
+                dst->buf_.data());
 }
 
 uint8_t Buffer::guess_single_byte_xor_key(std::string *out,
                                           float *score) const {
+  // Rank every key by the part of the score that only depends on which
+  // bytes appear: letter frequencies and unprintable characters. A key just
+  // relabels the histogram (byte b decrypts to b ^ key), so this takes
+  // 256 steps per distinct byte however long the buffer is. Without any
+  // whitespace there are no words, and the full score is infinite anyway.
+  size_t histogram[256];
+  HIST_count(buf_.data(), buf_.size(), histogram);
+  uint8_t present[256];
+  int distinct = 0;
+  for (int b = 0; b < 256; b++) {
+    if (histogram[b]) present[distinct++] = static_cast<uint8_t>(b);
+  }
+  const std::array<uint8_t, 256> &classes = char_classes();
+  std::array<std::pair<float, int>, 256> ranking;
+  for (int key = 0; key <= 255; key++) {
+    size_t counts[kOtherChar + 1] = {};
+    for (int i = 0; i < distinct; i++) {
+      counts[classes[present[i] ^ key]] += histogram[present[i]];
+    }
+    // in logs, since the unprintable factor overflows a float
+    float rank = INFINITY;
+    if (counts[kSpace]) {
+      rank = std::log(letter_distance(counts)) +
+             counts[kUnprintable] * std::log(2.0f);
+    }
+    ranking[key] = {rank, key};
+  }
+
+  // Only the best few candidates get the full score_text(), which also
+  // looks at words. They're tried in key order so that ties go the same way
+  // as trying every key.
+  std::partial_sort(ranking.begin(), ranking.begin() + kKeyCandidates,
+                    ranking.end());
+  std::sort(ranking.begin(), ranking.begin() + kKeyCandidates,
+            [](const auto &a, const auto &b) { return a.second < b.second; });
+
   uint8_t best_key = 0;
   float best_score = std::numeric_limits<float>::max();
-  for (int key = 0; key <= 255; key++) {
-    uint8_t k = static_cast<uint8_t>(key);
-    auto copy = *this;
-    copy.xor_byte(k);
-    float val = copy.string_score();
+  Buffer candidate;
+  candidate.reserve(size());
+  for (size_t i = 0; i < kKeyCandidates; i++) {
+    const uint8_t k = static_cast<uint8_t>(ranking[i].second);
+    xor_byte_into(k, &candidate);
+    float val = candidate.string_score();
     if (val < best_score) {
       best_score = val;
       best_key = k;
-      if (out != nullptr) *out = copy.encode();
+      if (out != nullptr) out->assign(candidate.view().str());
       if (score != nullptr) *score = val;
     }
   }
   return best_key;
 }
 
-size_t Buffer::edit_distance(const Buffer &other) {
+size_t BufferView::edit_distance(BufferView other) const {
   assert(size() == other.size());
-  size_t distance = 0;
-  for (size_t i = 0; i < buf_.size(); i++) {
-    const uint8_t diff = buf_[i] ^ other.buf_[i];
-    distance += __builtin_popcount(diff);
-  }
-  return distance;
+  return XOR_hamming(data_, other.data_, size_);
 }
 
-void Buffer::operator^=(const Buffer &other) {
+void Buffer::operator^=(BufferView other) {
   assert(size() == other.size());
-  for (size_t i = 0; i < buf_.size(); i++) {
-    buf_[i] ^= other.buf_[i];
-  }
+  XOR_buffers(buf_.data(), other.data(), buf_.size(), buf_.data());
 }
 
 std::string Buffer::guess_vigenere_key(size_t min_key_size, size_t max_key_size,
@@ -246,8 +230,8 @@ std::string Buffer::guess_vigenere_key(size_t min_key_size, size_t max_key_size,
     float dist = 0;
     for (int j = 0; j < 4; j++) {
       size_t off = width * j;
-      Buffer first = slice(off, off + width);
-      Buffer second = slice(off + width, off + 2 * width);
+      const BufferView first = slice(off, off + width);
+      const BufferView second = slice(off + width, off + 2 * width);
       dist += first.edit_distance(second);
     }
     key_size_entropies.push_back({width, dist / (float)width});
@@ -268,9 +252,9 @@ std::string Buffer::guess_vigenere_key(size_t min_key_size, size_t max_key_size,
     if (score < best_score) {
       best_score = score;
       best_key = key;
-      auto copy = *this;
-      copy.xor_string(key);
-      best_string = copy.encode();
+      Buffer plaintext;
+      xor_string_into(key, &plaintext);
+      best_string = plaintext.encode();
     }
   }
 
@@ -278,37 +262,31 @@ std::string Buffer::guess_vigenere_key(size_t min_key_size, size_t max_key_size,
 }
 
 std::string Buffer::guess_vigenere_key(size_t key_length, float *score) const {
-  std::ostringstream os;
+  std::string key;
+  key.reserve(key_length);
   for (const auto &buf : stack_and_transpose(key_length)) {
-    os << buf.guess_single_byte_xor_key();
+    key.push_back(buf.guess_single_byte_xor_key());
   }
 
-  const std::string key = os.str();
   assert(key.size() == key_length);
   if (score != nullptr) {
-    auto copy = *this;
-    copy.xor_string(key);
-    *score = copy.string_score();
+    Buffer plaintext;
+    xor_string_into(key, &plaintext);
+    *score = plaintext.string_score();
   }
   return key;
 }
 
 std::vector<Buffer> Buffer::stack_and_transpose(size_t width) const {
-  // First stack them.
-  std::vector<Buffer> vstack;
-  for (size_t i = 0; i < buf_.size(); i += width) {
-    vstack.push_back(slice(i, i + width));
-  }
-
-  std::vector<Buffer> transpose;
+  // Stacking the rows and reading down a column is the same as taking every
+  // width'th byte, so gather the columns directly.
+  std::vector<Buffer> transpose(width);
   for (size_t i = 0; i < width; i++) {
-    std::ostringstream os;
-    for (const auto &buf : vstack) {
-      if (i < buf.size()) {
-        os << buf[i];
-      }
+    auto &column = transpose[i].buf_;
+    column.reserve(buf_.size() / width + 1);
+    for (size_t j = i; j < buf_.size(); j += width) {
+      column.push_back(buf_[j]);
     }
-    transpose.emplace_back(os.str(), STRING);
   }
   return transpose;
 }
@@ -323,102 +301,474 @@ void Buffer::pad_pkcs7(uint8_t target_multiple) {
 
 void Buffer::unpad_pkcs7() {
   assert(!buf_.empty());
-  uint8_t padval = *buf_.rbegin();
+  uint8_t padval = buf_.back();
   assert(padval && buf_.size() >= padval);
   for (uint8_t i = 0; i < padval; i++) {
-    assert(*buf_.rbegin() == padval);
+    assert(buf_.back() == padval);
     buf_.pop_back();
   }
 }
 
-void Buffer::aes_ecb_decrypt(const std::string &key, bool pkcs7) {
-  assert(buf_.size() % AES_BLOCKLEN == 0);
+// Buffers this large (in bytes) are handled on the thread pool. Chunks are
+// sized to stay in L2, and are a multiple of the 8-block batch size.
+static std::atomic<size_t> parallel_threshold_bytes(1 << 20);
+static const size_t parallel_chunk = 64 << 10;
 
-  AES_ctx ctx;
-  AES_init_ctx(&ctx, (const uint8_t *)key.c_str());
+size_t Buffer::parallel_threshold() { return parallel_threshold_bytes; }
 
-  for (size_t i = 0; i < buf_.size(); i += AES_BLOCKLEN) {
-    AES_ECB_decrypt(&ctx, buf_.data() + i);
-  }
+void Buffer::set_parallel_threshold(size_t bytes) {
+  parallel_threshold_bytes = bytes;
 }
 
-static void xor_inplace(uint8_t *target, const uint8_t *iv) {
-  for (size_t i = 0; i < AES_BLOCKLEN; i++) {
-    *(target + i) ^= *(iv + i);
+// Call f(begin, end) for block aligned byte ranges covering [0, size), in
+// parallel if size is at least threshold. The threshold can change at any
+// time, so callers that need to know which way this will go read it once and
+// pass that in.
+template <typename F>
+static void for_each_chunk(size_t size, size_t threshold, F &&f) {
+  if (size < threshold) {
+    f(0, size);
+    return;
   }
+  ThreadPool::global().parallel_for(size, parallel_chunk, f);
 }
 
-void Buffer::aes_cbc_decrypt(const std::string &key, bool pkcs7) {
+template <typename F>
+static void for_each_chunk(size_t size, F &&f) {
+  for_each_chunk(size, parallel_threshold_bytes, std::forward<F>(f));
+}
+
+void Buffer::aes_ecb_decrypt(const AesKey &key, bool pkcs7) {
   assert(buf_.size() % AES_BLOCKLEN == 0);
 
-  AES_ctx ctx;
-  AES_init_ctx(&ctx, (const uint8_t *)key.c_str());
+  key.visit([this](const auto &cipher) {
+    for_each_chunk(buf_.size(), [this, &cipher](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i += AES_BLOCKLEN) {
+        cipher.decrypt(buf_.data() + i);
+      }
+    });
+  });
+}
 
-  uint8_t iv[AES_BLOCKLEN], iv_copy[AES_BLOCKLEN];
-  std::memset(iv, 0, AES_BLOCKLEN);
+void Buffer::aes_cbc_decrypt(const AesKey &key, bool pkcs7) {
+  assert(buf_.size() % AES_BLOCKLEN == 0);
 
-  for (size_t i = 0; i < buf_.size(); i += AES_BLOCKLEN) {
-    uint8_t *ptr = buf_.data() + i;
-    std::memmove(iv_copy, ptr, AES_BLOCKLEN);
-    AES_ECB_decrypt(&ctx, ptr);
-    xor_inplace(ptr, iv);
-    std::memmove(iv, iv_copy, AES_BLOCKLEN);
+  // Each plaintext block only depends on two ciphertext blocks, so chunks can
+  // be decrypted independently as long as each one starts from the last
+  // ciphertext block of the chunk before it. That block is decrypted in place
+  // by another thread, so grab all of the chunk IVs up front.
+  const size_t threshold = parallel_threshold_bytes;
+  std::vector<uint8_t> ivs;
+  if (buf_.size() >= threshold) {
+    for (size_t i = 0; i < buf_.size(); i += parallel_chunk) {
+      if (i == 0) {
+        ivs.insert(ivs.end(), AES_BLOCKLEN, 0);
+      } else {
+        ivs.insert(ivs.end(), buf_.begin() + i - AES_BLOCKLEN,
+                   buf_.begin() + i);
+      }
+    }
+  } else {
+    ivs.insert(ivs.end(), AES_BLOCKLEN, 0);
   }
 
+  key.visit([this, threshold, &ivs](const auto &cipher) {
+    for_each_chunk(buf_.size(), threshold, [this, &cipher, &ivs](size_t begin,
+                                                                 size_t end) {
+      uint8_t iv[AES_BLOCKLEN];
+      std::memmove(iv, ivs.data() + begin / parallel_chunk * AES_BLOCKLEN,
+                   AES_BLOCKLEN);
+      cbc_decrypt(cipher, iv, buf_.data() + begin, end - begin);
+    });
+  });
+
   if (pkcs7) unpad_pkcs7();
 }
 
-void Buffer::aes_ecb_encrypt(const std::string &key, bool pkcs7) {
+void Buffer::aes_ecb_encrypt(const AesKey &key, bool pkcs7) {
   if (pkcs7) pad_pkcs7(AES_BLOCKLEN);
   assert(buf_.size() % AES_BLOCKLEN == 0);
 
-  AES_ctx ctx;
-  AES_init_ctx(&ctx, (const uint8_t *)key.c_str());
+  key.visit([this](const auto &cipher) {
+    for_each_chunk(buf_.size(), [this, &cipher](size_t begin, size_t end) {
+      ecb_encrypt(cipher, buf_.data() + begin, end - begin);
+    });
+  });
+}
 
-  for (size_t i = 0; i < buf_.size(); i += AES_BLOCKLEN) {
-    AES_ECB_encrypt(&ctx, buf_.data() + i);
-  }
+void Buffer::aes_ecb_encrypt_into(const AesKey &key, Buffer *dst,
+                                  bool pkcs7) const {
+  assert(dst != this);
+  dst->buf_.clear();
+  dst->buf_.insert(dst->buf_.end(), buf_.begin(), buf_.end());
+  dst->aes_ecb_encrypt(key, pkcs7);
 }
 
-void Buffer::aes_cbc_encrypt(const std::string &key, bool pkcs7) {
+void Buffer::aes_cbc_encrypt(const AesKey &key, bool pkcs7) {
   if (pkcs7) pad_pkcs7(AES_BLOCKLEN);
   assert(buf_.size() % AES_BLOCKLEN == 0);
 
-  AES_ctx ctx;
-  AES_init_ctx(&ctx, (const uint8_t *)key.c_str());
+  key.visit([this](const auto &cipher) {
+    // TODO: make the iv configurable
+    uint8_t iv[AES_BLOCKLEN];
+    std::memset(iv, 0, AES_BLOCKLEN);
+    cbc_encrypt(cipher, iv, buf_.data(), buf_.size());
+  });
+}
+
+void Buffer::aes_ctr_xcrypt(const AesKey &key, uint64_t nonce,
+                            uint64_t offset) {
+  key.visit([this, nonce, offset](const auto &cipher) {
+    for_each_chunk(buf_.size(), [&](size_t begin, size_t end) {
+      ctr_xcrypt(cipher, nonce, offset + begin, buf_.data() + begin,
+                 end - begin);
+    });
+  });
+}
 
-  // TODO: make the iv configurable
-  uint8_t iv[AES_BLOCKLEN];
-  std::memset(iv, 0, AES_BLOCKLEN);
+void Buffer::aes_ctr_edit(const AesKey &key, uint64_t nonce, size_t offset,
+                          const Buffer &newtext) {
+  assert(offset <= buf_.size());
+  Buffer ciphertext = newtext;
+  ciphertext.aes_ctr_xcrypt(key, nonce, offset);
+  if (buf_.size() < offset + ciphertext.size()) {
+    buf_.resize_uninitialized(offset + ciphertext.size());
+  }
+  std::memmove(buf_.data() + offset, ciphertext.buf_.data(),
+               ciphertext.size());
+}
 
-  for (size_t i = 0; i < buf_.size(); i += AES_BLOCKLEN) {
-    xor_inplace(buf_.data() + i, i == 0 ? iv : buf_.data() + i - AES_BLOCKLEN);
-    AES_ECB_encrypt(&ctx, buf_.data() + i);
+void Buffer::aes_ecb_decrypt(const std::string &key, bool pkcs7) {
+  aes_ecb_decrypt(*AesKey::cached(key), pkcs7);
+}
+
+void Buffer::aes_cbc_decrypt(const std::string &key, bool pkcs7) {
+  aes_cbc_decrypt(*AesKey::cached(key), pkcs7);
+}
+
+void Buffer::aes_ecb_encrypt(const std::string &key, bool pkcs7) {
+  aes_ecb_encrypt(*AesKey::cached(key), pkcs7);
+}
+
+void Buffer::aes_ecb_encrypt_into(const std::string &key, Buffer *dst,
+                                  bool pkcs7) const {
+  aes_ecb_encrypt_into(*AesKey::cached(key), dst, pkcs7);
+}
+
+void Buffer::aes_cbc_encrypt(const std::string &key, bool pkcs7) {
+  aes_cbc_encrypt(*AesKey::cached(key), pkcs7);
+}
+
+void Buffer::aes_ctr_xcrypt(const std::string &key, uint64_t nonce,
+                            uint64_t offset) {
+  aes_ctr_xcrypt(*AesKey::cached(key), nonce, offset);
+}
+
+void Buffer::aes_ctr_edit(const std::string &key, uint64_t nonce,
+                          size_t offset, const Buffer &newtext) {
+  aes_ctr_edit(*AesKey::cached(key), nonce, offset, newtext);
+}
+
+static uint32_t load_be32(const uint8_t *in) {
+  return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) |
+         (uint32_t(in[2]) << 8) | in[3];
+}
+
+static void store_be32(uint8_t *out, uint32_t val) {
+  for (size_t i = 0; i < 4; i++) {
+    out[i] = static_cast<uint8_t>(val >> (24 - 8 * i));
+  }
+}
+
+namespace {
+// Per-message GCM state: the hash key and the pre-counter block J0.
+struct GcmContext {
+  GHASH_ctx ghash;
+  uint8_t j0[AES_BLOCKLEN];
+};
+}  // namespace
+
+// GHASH data, zero padding the last partial block.
+static void ghash_padded(const GHASH_ctx &ghash, uint8_t *y,
+                         const uint8_t *data, size_t size) {
+  const size_t full = size - size % GHASH_BLOCKLEN;
+  GHASH_update(&ghash, y, data, full);
+  if (full != size) {
+    uint8_t last[GHASH_BLOCKLEN] = {0};
+    std::memmove(last, data + full, size - full);
+    GHASH_update(&ghash, y, last, GHASH_BLOCKLEN);
+  }
+}
+
+template <typename Cipher>
+static void gcm_init(const Cipher &cipher, const uint8_t *iv, size_t iv_size,
+                     GcmContext *ctx) {
+  const int use_clmul = GHASH_clmul_supported();
+  uint8_t h[AES_BLOCKLEN] = {0};
+  cipher.encrypt(h);
+  GHASH_init(&ctx->ghash, h, use_clmul);
+
+  std::memset(ctx->j0, 0, AES_BLOCKLEN);
+  if (iv_size == 12) {
+    std::memmove(ctx->j0, iv, iv_size);
+    ctx->j0[AES_BLOCKLEN - 1] = 1;
+  } else {
+    ghash_padded(ctx->ghash, ctx->j0, iv, iv_size);
+    uint8_t lengths[GHASH_BLOCKLEN] = {0};
+    store_be32(lengths + 8, static_cast<uint32_t>(uint64_t(iv_size) >> 29));
+    store_be32(lengths + 12, static_cast<uint32_t>(iv_size << 3));
+    GHASH_update(&ctx->ghash, ctx->j0, lengths, GHASH_BLOCKLEN);
+  }
+}
+
+// GCM's CTR mode: the last 32 bits of J0 are a big endian counter, and the
+// first block uses J0 + 1.
+template <typename Cipher>
+static void gcm_ctr(const Cipher &cipher, const GcmContext &ctx,
+                    uint8_t *data, size_t size) {
+  uint8_t keystream[AES_BLOCKLEN * AES_ECB_BATCH];
+  uint32_t counter = load_be32(ctx.j0 + 12) + 1;
+  while (size) {
+    const size_t want = (size + AES_BLOCKLEN - 1) / AES_BLOCKLEN;
+    const size_t blocks = std::min<size_t>(want, AES_ECB_BATCH);
+    for (size_t i = 0; i < blocks; i++) {
+      std::memmove(keystream + i * AES_BLOCKLEN, ctx.j0, 12);
+      store_be32(keystream + i * AES_BLOCKLEN + 12,
+                 counter + static_cast<uint32_t>(i));
+    }
+    if (blocks == AES_ECB_BATCH) {
+      cipher.encrypt8(keystream);
+    } else {
+      for (size_t i = 0; i < blocks; i++) {
+        cipher.encrypt(keystream + i * AES_BLOCKLEN);
+      }
+    }
+
+    const size_t n = std::min(size, blocks * AES_BLOCKLEN);
+    for (size_t i = 0; i < n; i++) {
+      data[i] ^= keystream[i];
+    }
+    data += n;
+    size -= n;
+    counter += static_cast<uint32_t>(blocks);
+  }
+}
+
+template <typename Cipher>
+static void gcm_tag(const Cipher &cipher, const GcmContext &ctx,
+                    const uint8_t *aad, size_t aad_size,
+                    const uint8_t *ciphertext, size_t size, uint8_t *tag) {
+  uint8_t y[GHASH_BLOCKLEN] = {0};
+  ghash_padded(ctx.ghash, y, aad, aad_size);
+  ghash_padded(ctx.ghash, y, ciphertext, size);
+
+  // bit lengths of the aad and ciphertext, as 64-bit big endian integers
+  uint8_t lengths[GHASH_BLOCKLEN];
+  store_be32(lengths, static_cast<uint32_t>(uint64_t(aad_size) >> 29));
+  store_be32(lengths + 4, static_cast<uint32_t>(aad_size << 3));
+  store_be32(lengths + 8, static_cast<uint32_t>(uint64_t(size) >> 29));
+  store_be32(lengths + 12, static_cast<uint32_t>(size << 3));
+  GHASH_update(&ctx.ghash, y, lengths, GHASH_BLOCKLEN);
+
+  std::memmove(tag, ctx.j0, AES_BLOCKLEN);
+  cipher.encrypt(tag);
+  for (size_t i = 0; i < AES_BLOCKLEN; i++) {
+    tag[i] ^= y[i];
+  }
+}
+
+Buffer Buffer::aes_gcm_encrypt(const AesKey &key, const Buffer &iv,
+                               const Buffer &aad) {
+  Buffer tag;
+  tag.buf_.resize_uninitialized(AES_BLOCKLEN);
+  key.visit([&](const auto &cipher) {
+    GcmContext ctx;
+    gcm_init(cipher, iv.buf_.data(), iv.size(), &ctx);
+    gcm_ctr(cipher, ctx, buf_.data(), buf_.size());
+    gcm_tag(cipher, ctx, aad.buf_.data(), aad.size(), buf_.data(),
+            buf_.size(), tag.buf_.data());
+  });
+  return tag;
+}
+
+// Compares the tag computed from ctx against tag, without leaking how much
+// of it matched.
+template <typename Cipher>
+static bool gcm_check(const Cipher &cipher, const GcmContext &ctx,
+                      const Buffer &aad, const Buffer &ciphertext,
+                      const Buffer &tag) {
+  uint8_t expected[AES_BLOCKLEN];
+  gcm_tag(cipher, ctx, aad.view().data(), aad.size(),
+          ciphertext.view().data(), ciphertext.size(), expected);
+  uint8_t diff = 0;
+  for (size_t i = 0; i < AES_BLOCKLEN; i++) {
+    diff |= expected[i] ^ tag[i];
+  }
+  return diff == 0;
+}
+
+bool Buffer::aes_gcm_verify(const AesKey &key, const Buffer &iv,
+                            const Buffer &tag, const Buffer &aad) const {
+  if (tag.size() != AES_BLOCKLEN) return false;
+  bool ok = false;
+  key.visit([&](const auto &cipher) {
+    GcmContext ctx;
+    gcm_init(cipher, iv.buf_.data(), iv.size(), &ctx);
+    ok = gcm_check(cipher, ctx, aad, *this, tag);
+  });
+  return ok;
+}
+
+bool Buffer::aes_gcm_decrypt(const AesKey &key, const Buffer &iv,
+                             const Buffer &tag, const Buffer &aad) {
+  if (tag.size() != AES_BLOCKLEN) return false;
+  bool ok = false;
+  key.visit([&](const auto &cipher) {
+    GcmContext ctx;
+    gcm_init(cipher, iv.buf_.data(), iv.size(), &ctx);
+    ok = gcm_check(cipher, ctx, aad, *this, tag);
+    if (ok) gcm_ctr(cipher, ctx, buf_.data(), buf_.size());
+  });
+  return ok;
+}
+
+Buffer Buffer::aes_gcm_encrypt(const std::string &key, const Buffer &iv,
+                               const Buffer &aad) {
+  return aes_gcm_encrypt(*AesKey::cached(key), iv, aad);
+}
+
+bool Buffer::aes_gcm_verify(const std::string &key, const Buffer &iv,
+                            const Buffer &tag, const Buffer &aad) const {
+  return aes_gcm_verify(*AesKey::cached(key), iv, tag, aad);
+}
+
+bool Buffer::aes_gcm_decrypt(const std::string &key, const Buffer &iv,
+                             const Buffer &tag, const Buffer &aad) {
+  return aes_gcm_decrypt(*AesKey::cached(key), iv, tag, aad);
+}
+
+namespace {
+// A message for cbc_encrypt_interleaved(), already padded.
+struct CbcMessage {
+  const uint8_t *key;
+  const uint8_t *iv;
+  uint8_t *data;
+  size_t size;
+};
+}  // namespace
+
+// CBC encrypt messages that all have KeyBits keys, AES_ECB_BATCH at a time:
+// each step encrypts the next block of every message in flight, and a
+// message that finishes is replaced by the next one waiting.
+template <size_t KeyBits>
+static void cbc_encrypt_interleaved(const std::vector<CbcMessage> &messages) {
+  using Cipher = AesCipher<KeyBits>;
+  std::optional<Cipher> ciphers[AES_ECB_BATCH];
+  uint8_t *pos[AES_ECB_BATCH], *end[AES_ECB_BATCH];
+  const uint8_t *prev[AES_ECB_BATCH];
+
+  size_t next = 0;
+  auto start_message = [&](size_t lane) {
+    while (next < messages.size()) {
+      const CbcMessage &msg = messages[next++];
+      if (!msg.size) continue;
+      ciphers[lane].emplace(msg.key);
+      pos[lane] = msg.data;
+      end[lane] = msg.data + msg.size;
+      prev[lane] = msg.iv;
+      return true;
+    }
+    return false;
+  };
+
+  size_t active = 0;
+  while (active < AES_ECB_BATCH && start_message(active)) {
+    active++;
+  }
+
+  const Cipher *lane_ciphers[AES_ECB_BATCH];
+  while (active) {
+    for (size_t i = 0; i < active; i++) {
+      xor_inplace(pos[i], prev[i]);
+      lane_ciphers[i] = &*ciphers[i];
+    }
+    Cipher::encrypt_lanes(lane_ciphers, pos, active);
+    for (size_t i = 0; i < active; i++) {
+      prev[i] = pos[i];
+      pos[i] += AES_BLOCKLEN;
+      if (pos[i] == end[i] && !start_message(i)) {
+        // nothing left to start, so move the last lane into this one
+        active--;
+        if (i != active) {
+          ciphers[i] = std::move(ciphers[active]);
+          pos[i] = pos[active];
+          end[i] = end[active];
+          prev[i] = prev[active];
+          i--;
+        }
+      }
+    }
+  }
+}
+
+void Buffer::aes_cbc_encrypt_batch(const std::vector<CbcJob> &jobs,
+                                   bool pkcs7) {
+  static const uint8_t zero_iv[AES_BLOCKLEN] = {0};
+
+  // Lanes have to use the same number of rounds, so group by key size.
+  std::vector<CbcMessage> messages[3];
+  for (const auto &job : jobs) {
+    Buffer *buf = job.buf;
+    if (pkcs7) buf->pad_pkcs7(AES_BLOCKLEN);
+    assert(buf->size() % AES_BLOCKLEN == 0);
+    assert(job.iv.empty() || job.iv.size() == AES_BLOCKLEN);
+
+    CbcMessage msg{reinterpret_cast<const uint8_t *>(job.key.data()),
+                   job.iv.empty()
+                       ? zero_iv
+                       : reinterpret_cast<const uint8_t *>(job.iv.data()),
+                   buf->buf_.data(), buf->size()};
+    switch (job.key.size()) {
+      case AesCipher<128>::kKeyLength:
+        messages[0].push_back(msg);
+        break;
+      case AesCipher<192>::kKeyLength:
+        messages[1].push_back(msg);
+        break;
+      case AesCipher<256>::kKeyLength:
+        messages[2].push_back(msg);
+        break;
+      default:
+        assert(false);  // not a valid AES key size
+        break;
+    }
   }
+  cbc_encrypt_interleaved<128>(messages[0]);
+  cbc_encrypt_interleaved<192>(messages[1]);
+  cbc_encrypt_interleaved<256>(messages[2]);
 }
 
 void Buffer::obfuscate(size_t min_bytes, size_t max_bytes) {
   std::string front = rand_string(min_bytes, max_bytes);
   std::string back = rand_string(min_bytes, max_bytes);
 
-  std::vector<uint8_t> buf(front.size() + buf_.size() + back.size());
-  std::memmove(buf.data(), front.data(), front.size());
-  std::memmove(buf.data() + front.size(), buf_.data(), buf_.size());
-  std::memmove(buf.data() + front.size() + buf_.size(), back.data(),
-               back.size());
-  buf_ = buf;
+  buf_.insert(buf_.begin(), front.begin(), front.end());
+  buf_.insert(buf_.end(), back.begin(), back.end());
 }
 
-std::string Buffer::guess_encryption_mode(size_t min_key_size,
-                                          size_t max_key_size) const {
+std::string BufferView::guess_encryption_mode(size_t min_key_size,
+                                              size_t max_key_size) const {
   // N.B. prefer larger key sizes
   size_t best_key_size = 0, best_count = 0;
+  const std::string_view data = str();
+  Arena arena;
   for (size_t sz = min_key_size; sz <= max_key_size; sz += 4) {
     if (size() % sz) continue;
-    Counter<std::string> counter;
-    std::string data = encode();
-    assert(data.size() == buf_.size());
-    for (size_t i = 0; i < buf_.size(); i += sz) {
+    arena.reset();
+    Counter<std::string_view,
+            ArenaAllocator<std::pair<const std::string_view, size_t>>>
+        counter((ArenaAllocator<std::string_view>(&arena)));
+    for (size_t i = 0; i < size_; i += sz) {
       counter.add(data.substr(i, sz));
     }
 
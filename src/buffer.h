@@ -20,8 +20,11 @@
 #include <iterator>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "./small_vector.h"
+
 namespace cryptopals {
 
 enum Encoding {
@@ -31,49 +34,158 @@ enum Encoding {
   BASE64_FILE,
 };
 
+// Where a Buffer's storage comes from once it's too big to keep inline.
+enum StoragePolicy {
+  HEAP_STORAGE,
+  // Payloads of kHugePageSize and up are mapped with huge pages, which cuts
+  // TLB misses on passes over very large data. Smaller ones use the heap.
+  HUGE_PAGE_STORAGE,
+};
+
+class AesKey;
+class Arena;
+class Buffer;
+
+// A read-only window onto bytes owned by something else, usually a Buffer.
+// Slicing and analysis go through views so they don't copy; the owner has to
+// outlive the view, and must not be resized while it's in use.
+class BufferView {
+ public:
+  BufferView() : data_(nullptr), size_(0) {}
+  BufferView(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  inline const uint8_t *data() const { return data_; }
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0; }
+  inline const uint8_t *begin() const { return data_; }
+  inline const uint8_t *end() const { return data_ + size_; }
+  inline uint8_t operator[](size_t i) const { return data_[i]; }
+
+  bool operator==(BufferView other) const;
+  inline bool operator!=(BufferView other) const { return !(*this == other); }
+
+  // like Buffer::slice(), end is clamped to the size
+  BufferView slice(size_t start, size_t end) const;
+
+  // the bytes as characters, without copying
+  inline std::string_view str() const {
+    return {reinterpret_cast<const char *>(data_), size_};
+  }
+
+  inline std::string encode() const { return std::string(str()); }
+  std::string encode_hex() const;
+  std::string encode_base64() const;
+
+  // like encode_hex(), but reusing the storage in out
+  void encode_hex_into(std::string *out) const;
+
+  // Get the score of this buffer as a string.
+  float string_score() const;
+
+  // number of bits in the delta between the two
+  size_t edit_distance(BufferView other) const;
+
+  // return ECB or CBC based on our guess
+  std::string guess_encryption_mode(size_t min_key_size = 8,
+                                    size_t max_key_size = 32) const;
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+};
+
+// One message for Buffer::aes_cbc_encrypt_batch(). An empty iv means all
+// zeros, like aes_cbc_encrypt().
+struct CbcJob {
+  std::string key;
+  std::string iv;
+  Buffer *buf;
+};
+
 class Buffer {
  public:
+  // Payloads up to this many bytes (blocks, keys, ivs, short slices) are
+  // stored in the Buffer itself instead of on the heap.
+  static constexpr size_t kInlineSize = 64;
+
   Buffer() {}
-  explicit Buffer(const std::string &s, Encoding encoding = STRING);
-  explicit Buffer(const std::vector<uint8_t> &buf) : buf_(buf) {}
-  Buffer(const Buffer &other) : buf_(other.buf_) {}
+  // The storage is sized from the input up front, using policy.
+  explicit Buffer(const std::string &s, Encoding encoding = STRING,
+                  StoragePolicy policy = HEAP_STORAGE);
+  explicit Buffer(const std::vector<uint8_t> &buf)
+      : buf_(buf.begin(), buf.end()) {}
+  explicit Buffer(BufferView view) : buf_(view.begin(), view.end()) {}
+  Buffer(const Buffer &other) = default;
+  Buffer(Buffer &&other) noexcept = default;
+  Buffer &operator=(const Buffer &other) = default;
+  Buffer &operator=(Buffer &&other) noexcept = default;
 
   inline size_t size() const { return buf_.size(); }
 
-  inline bool operator==(const Buffer &other) const {
-    return buf_ == other.buf_;
+  // make room for n bytes without reallocating
+  inline void reserve(size_t n) { buf_.reserve(n); }
+
+  // like reserve(), but also set the storage policy for this and any later
+  // growth
+  inline void reserve(size_t n, StoragePolicy policy) {
+    buf_.set_huge_pages(policy == HUGE_PAGE_STORAGE);
+    buf_.reserve(n);
   }
 
-  inline void append(const Buffer &other) {
-    buf_.insert(buf_.end(), other.buf_.begin(), other.buf_.end());
+  // Buffers can be passed anywhere a BufferView is expected; the view is only
+  // good until the buffer is modified.
+  inline BufferView view() const { return {buf_.data(), buf_.size()}; }
+  inline operator BufferView() const { return view(); }
+
+  inline bool operator==(BufferView other) const { return view() == other; }
+
+  inline void append(BufferView other) {
+    buf_.insert(buf_.end(), other.begin(), other.end());
   }
 
   inline void append(uint8_t byte) { buf_.push_back(byte); }
 
-  Buffer slice(size_t start, size_t end) const;
+  // a view of [start, end), no copying; wrap it in a Buffer to get a copy
+  inline BufferView slice(size_t start, size_t end) const {
+    return view().slice(start, end);
+  }
 
-  inline std::string encode() const {
-    return {reinterpret_cast<const char *>(buf_.data()), buf_.size()};
+  inline std::string encode() const { return view().encode(); }
+  inline std::string encode_hex() const { return view().encode_hex(); }
+  inline void encode_hex_into(std::string *out) const {
+    view().encode_hex_into(out);
   }
-  std::string encode_hex() const;
-  std::string encode_base64() const;
+  inline std::string encode_base64() const { return view().encode_base64(); }
 
   // Get the score of this buffer as a string.
-  float string_score() const;
+  inline float string_score() const { return view().string_score(); }
 
-  void operator^=(const Buffer &other);
+  void operator^=(BufferView other);
 
   inline uint8_t operator[](size_t i) const { return buf_[i]; }
 
   void xor_byte(uint8_t key);
 
+  // Like xor_byte(), but writes the result to dst and leaves this buffer
+  // alone. dst keeps its storage, so reusing it across calls doesn't
+  // allocate.
+  void xor_byte_into(uint8_t key, Buffer *dst) const;
+
   void xor_string(const std::string &key);
 
+  // Like xor_string(), but writes the result to dst, as xor_byte_into().
+  void xor_string_into(const std::string &key, Buffer *dst) const;
+
+  // Keys are ranked by letter frequencies from a byte histogram, and the
+  // best kKeyCandidates get a full string_score().
+  static constexpr size_t kKeyCandidates = 16;
   uint8_t guess_single_byte_xor_key(std::string *out = nullptr,
                                     float *score = nullptr) const;
 
   // number of bits in the delta between the two
-  size_t edit_distance(const Buffer &other);
+  inline size_t edit_distance(BufferView other) const {
+    return view().edit_distance(other);
+  }
 
   // guess the key for a vigenere cipher
   std::string guess_vigenere_key(size_t min_key_size, size_t max_key_size,
@@ -85,31 +197,97 @@ class Buffer {
   // undo padding bytes, as defined by pkcs #7
   void unpad_pkcs7();
 
+  // The AES functions take either an expanded AesKey or a raw 16, 24 or 32
+  // byte key. Raw keys are expanded through a small cache (see
+  // AesKey::cached), but holding on to an AesKey skips even that.
+
   // ecb decrypt *in place*
+  void aes_ecb_decrypt(const AesKey &key, bool pkcs7 = true);
   void aes_ecb_decrypt(const std::string &key, bool pkcs7 = true);
 
   // cbc decrypt *in place*
+  void aes_cbc_decrypt(const AesKey &key, bool pkcs7 = true);
   void aes_cbc_decrypt(const std::string &key, bool pkcs7 = true);
 
   // ecb encrypt *in place*
+  void aes_ecb_encrypt(const AesKey &key, bool pkcs7 = true);
   void aes_ecb_encrypt(const std::string &key, bool pkcs7 = true);
 
+  // ecb encrypt into dst, reusing its storage
+  void aes_ecb_encrypt_into(const AesKey &key, Buffer *dst,
+                            bool pkcs7 = true) const;
+  void aes_ecb_encrypt_into(const std::string &key, Buffer *dst,
+                            bool pkcs7 = true) const;
+
   // cbc encrypt *in place*
+  void aes_cbc_encrypt(const AesKey &key, bool pkcs7 = true);
   void aes_cbc_encrypt(const std::string &key, bool pkcs7 = true);
 
+  // ctr encrypt/decrypt *in place*. The keystream is the one used by
+  // cryptopals: a 64-bit little endian nonce followed by a 64-bit little
+  // endian block counter. offset is where this buffer starts in the
+  // keystream, in bytes, so any range can be processed on its own.
+  void aes_ctr_xcrypt(const AesKey &key, uint64_t nonce, uint64_t offset = 0);
+  void aes_ctr_xcrypt(const std::string &key, uint64_t nonce,
+                      uint64_t offset = 0);
+
+  // overwrite the plaintext at offset in a ctr encrypted buffer with newtext,
+  // growing the buffer if needed; only the keystream for the blocks touched
+  // is generated. offset can be at most size(), since a gap wouldn't be
+  // valid ciphertext.
+  void aes_ctr_edit(const AesKey &key, uint64_t nonce, size_t offset,
+                    const Buffer &newtext);
+  void aes_ctr_edit(const std::string &key, uint64_t nonce, size_t offset,
+                    const Buffer &newtext);
+
+  // gcm encrypt *in place*, returning the 16 byte authentication tag. The iv
+  // can be any length, but 12 bytes is the standard (and fastest) choice.
+  Buffer aes_gcm_encrypt(const AesKey &key, const Buffer &iv,
+                         const Buffer &aad = Buffer());
+  Buffer aes_gcm_encrypt(const std::string &key, const Buffer &iv,
+                         const Buffer &aad = Buffer());
+
+  // check the gcm tag for this ciphertext, without decrypting it
+  bool aes_gcm_verify(const AesKey &key, const Buffer &iv, const Buffer &tag,
+                      const Buffer &aad = Buffer()) const;
+  bool aes_gcm_verify(const std::string &key, const Buffer &iv,
+                      const Buffer &tag, const Buffer &aad = Buffer()) const;
+
+  // gcm decrypt *in place* if the tag is valid; otherwise the buffer is left
+  // alone and false is returned
+  bool aes_gcm_decrypt(const AesKey &key, const Buffer &iv, const Buffer &tag,
+                       const Buffer &aad = Buffer());
+  bool aes_gcm_decrypt(const std::string &key, const Buffer &iv,
+                       const Buffer &tag, const Buffer &aad = Buffer());
+
+  // cbc encrypt many independent messages *in place*. CBC encryption is
+  // serial within a message, so this interleaves blocks from several messages
+  // to keep the AES pipeline busy. Same results as calling aes_cbc_encrypt()
+  // on each one.
+  static void aes_cbc_encrypt_batch(const std::vector<CbcJob> &jobs,
+                                    bool pkcs7 = true);
+
+  // Buffers of at least this many bytes are encrypted/decrypted in chunks on
+  // the global thread pool (ECB in both directions, and CBC decryption).
+  // Results are identical to the serial path.
+  static size_t parallel_threshold();
+  static void set_parallel_threshold(size_t bytes);
+
   // add [min_bytes, max_bytes] random data at the head of the string, and same
   // at the end
   void obfuscate(size_t min_bytes, size_t max_bytes);
 
   // return ECB or CBC based on our guess
-  std::string guess_encryption_mode(size_t min_key_size = 8,
-                                    size_t max_key_size = 32) const;
+  inline std::string guess_encryption_mode(size_t min_key_size = 8,
+                                           size_t max_key_size = 32) const {
+    return view().guess_encryption_mode(min_key_size, max_key_size);
+  }
   std::string guess_encryption_mode(size_t key_size) const {
     return guess_encryption_mode(key_size, key_size);
   }
 
  private:
-  std::vector<uint8_t> buf_;
+  SmallVector<uint8_t, kInlineSize> buf_;
 
   // set the buffer contents based on base64 data
   void set_base64_data(const std::string &s);
@@ -117,9 +295,6 @@ class Buffer {
   // guess the key, and return it
   std::string guess_vigenere_key(size_t key_length, float *score) const;
 
-  // try a single byte xor key, and return the score for the key
-  float try_single_byte_xor_key(uint8_t key) const;
-
   // vertically stack the buffers along some width
   std::vector<Buffer> stack_and_transpose(size_t width) const;
 };
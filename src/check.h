@@ -0,0 +1,27 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <iostream>
+
+// Fail the enclosing solution or test (which returns bool) if cond is false,
+// saying where.
+#define CHECK(cond)                                                           \
+  if (!(cond)) {                                                              \
+    std::cerr << "CHECK failed " __FILE__ ":" << __LINE__ << ": " #cond "\n"; \
+    return false;                                                             \
+  }
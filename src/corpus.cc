@@ -0,0 +1,148 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "./corpus.h"
+
+#include <endian.h>
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "./base64.h"
+#include "./hex.h"
+
+namespace cryptopals {
+
+static const char corpus_magic[8] = {'C', 'P', 'C', 'O', 'R', 'P', 'U', 'S'};
+static const size_t header_size = sizeof(corpus_magic) + 2 * sizeof(uint64_t);
+
+static inline uint64_t load_u64(const char *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return le64toh(v);
+}
+
+static inline void write_u64(std::ofstream &out, uint64_t v) {
+  v = htole64(v);
+  out.write(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+// Decode one line of hex or base64, returning false if it isn't valid.
+static bool decode_line(const std::string &line, TextFormat format,
+                        std::vector<uint8_t> *record) {
+  if (format == HEX_LINES) {
+    if (line.size() % 2) return false;
+    record->resize(line.size() / 2);
+    return HEX_decode(line.data(), line.size(), record->data());
+  }
+  record->resize(BASE64_DECODED_MAX(line.size()));
+  size_t size;
+  if (!BASE64_decode(line.data(), line.size(), record->data(), &size)) {
+    return false;
+  }
+  record->resize(size);
+  return true;
+}
+
+bool write_corpus(const std::string &in_path, TextFormat format,
+                  const std::string &out_path) {
+  std::vector<std::vector<uint8_t>> records;
+  if (format == BASE64_TEXT) {
+    if (!std::ifstream(in_path)) return false;
+    const MappedFile file(in_path);
+    std::vector<uint8_t> &record = records.emplace_back(
+        BASE64_DECODED_MAX(file.size() + 3));
+    BASE64_decoder decoder;
+    BASE64_decoder_init(&decoder);
+    size_t size;
+    if (!BASE64_decoder_update(&decoder, file.data(), file.size(),
+                               record.data(), &size) ||
+        !BASE64_decoder_finish(&decoder)) {
+      return false;
+    }
+    record.resize(size);
+  } else {
+    std::ifstream infile(in_path);
+    if (!infile) return false;
+    std::string line;
+    while (std::getline(infile, line)) {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      if (line.empty()) continue;
+      if (!decode_line(line, format, &records.emplace_back())) return false;
+    }
+  }
+
+  std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+  if (!out) return false;
+  std::vector<uint64_t> index;
+  uint64_t offset = header_size;
+  for (const auto &record : records) {
+    index.push_back(offset);
+    offset += sizeof(uint64_t) + (record.size() + 7) / 8 * 8;
+  }
+
+  out.write(corpus_magic, sizeof(corpus_magic));
+  write_u64(out, records.size());
+  write_u64(out, offset);
+  static const char padding[8] = {};
+  for (const auto &record : records) {
+    write_u64(out, record.size());
+    out.write(reinterpret_cast<const char *>(record.data()), record.size());
+    out.write(padding, (8 - record.size() % 8) % 8);
+  }
+  for (uint64_t record_offset : index) {
+    write_u64(out, record_offset);
+  }
+  return static_cast<bool>(out);
+}
+
+Corpus::Corpus(const std::string &path)
+    : file_(path), index_(nullptr), size_(0) {
+  const char *data = file_.data();
+  const size_t file_size = file_.size();
+  if (file_size < header_size ||
+      std::memcmp(data, corpus_magic, sizeof(corpus_magic)) != 0) {
+    return;
+  }
+  const uint64_t count = load_u64(data + sizeof(corpus_magic));
+  const uint64_t index_offset = load_u64(data + sizeof(corpus_magic) + 8);
+  if (index_offset > file_size ||
+      count > (file_size - index_offset) / sizeof(uint64_t)) {
+    return;
+  }
+
+  // check every record up front so operator[] doesn't have to
+  for (uint64_t i = 0; i < count; i++) {
+    const uint64_t offset = load_u64(data + index_offset + i * 8);
+    if (offset > index_offset || index_offset - offset < sizeof(uint64_t) ||
+        load_u64(data + offset) > index_offset - offset - sizeof(uint64_t)) {
+      return;
+    }
+  }
+  index_ = data + index_offset;
+  size_ = count;
+}
+
+BufferView Corpus::operator[](size_t i) const {
+  assert(i < size_);
+  const char *record = file_.data() + load_u64(index_ + i * 8);
+  return {reinterpret_cast<const uint8_t *>(record) + sizeof(uint64_t),
+          load_u64(record)};
+}
+}  // namespace cryptopals
@@ -0,0 +1,66 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "./buffer.h"
+#include "./mapped_file.h"
+
+namespace cryptopals {
+
+// A corpus holds the records of one of the text inputs (e.g. each line of
+// data/4.txt, decoded from hex) already decoded, so a run can map the file
+// and use the records in place instead of parsing text. The layout is
+// little-endian:
+//
+//   header   "CPCORPUS", uint64 record count, uint64 offset of the index
+//   records  uint64 length, then the bytes, zero padded to 8 bytes
+//   index    uint64 offset of each record, in order
+enum TextFormat {
+  HEX_LINES,     // one record per line of hex
+  BASE64_LINES,  // one record per line of base64
+  BASE64_TEXT,   // the whole file is one wrapped base64 record
+};
+
+// Parse the text file at in_path and write its records to out_path as a
+// corpus. Returns false if either file can't be opened, or if the text isn't
+// valid hex or base64, in which case out_path isn't touched.
+bool write_corpus(const std::string &in_path, TextFormat format,
+                  const std::string &out_path);
+
+class Corpus {
+ public:
+  // A file that's missing or isn't a well formed corpus opens as invalid.
+  explicit Corpus(const std::string &path);
+  Corpus(const Corpus &other) = delete;
+
+  inline bool valid() const { return index_ != nullptr; }
+  inline size_t size() const { return size_; }
+
+  // the record's bytes, pointing into the mapping
+  BufferView operator[](size_t i) const;
+
+ private:
+  MappedFile file_;
+  const char *index_;
+  size_t size_;
+};
+}  // namespace cryptopals
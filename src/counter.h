@@ -16,12 +16,21 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <unordered_map>
+#include <utility>
 
 namespace cryptopals {
-template <typename T>
+// Counts of each distinct value. The allocator is used for the map, so a
+// counter that's only needed for one search can live in an Arena.
+template <typename T,
+          typename Allocator = std::allocator<std::pair<const T, size_t>>>
 class Counter {
  public:
+  explicit Counter(const Allocator &alloc = Allocator())
+      : counts_(0, std::hash<T>(), std::equal_to<T>(), alloc) {}
+
   size_t add(const T &val) {
     auto it = counts_.find(val);
     if (it == counts_.end()) {
@@ -43,6 +52,7 @@ class Counter {
   }
 
  private:
-  std::unordered_map<T, size_t> counts_;
+  std::unordered_map<T, size_t, std::hash<T>, std::equal_to<T>, Allocator>
+      counts_;
 };
 }  // namespace cryptopals
@@ -0,0 +1,137 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "cpu.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned tier_features[] = {
+    0,
+    CPU_SSSE3 | CPU_SSE41 | CPU_POPCNT | CPU_AESNI | CPU_PCLMUL,
+    CPU_SSSE3 | CPU_SSE41 | CPU_POPCNT | CPU_AESNI | CPU_PCLMUL | CPU_AVX2,
+    CPU_SSSE3 | CPU_SSE41 | CPU_POPCNT | CPU_AESNI | CPU_PCLMUL | CPU_AVX2 |
+        CPU_AVX512F | CPU_AVX512BW,
+};
+
+static const char* const tier_names[] = {"scalar", "sse", "avx2", "avx512"};
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <cpuid.h>
+
+static unsigned detect(void) {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return 0;
+  }
+  unsigned features = 0;
+  if (ecx & bit_SSSE3) features |= CPU_SSSE3;
+  if (ecx & bit_SSE4_1) features |= CPU_SSE41;
+  if (ecx & bit_POPCNT) features |= CPU_POPCNT;
+  if (ecx & bit_AES) features |= CPU_AESNI;
+  if (ecx & bit_PCLMUL) features |= CPU_PCLMUL;
+
+  // the wider registers are only usable if the OS saves them, per XCR0
+  unsigned int xcr0 = 0, xcr0_hi;
+  if (ecx & bit_OSXSAVE) {
+    __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0));
+  }
+  if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    if ((xcr0 & 0x6) == 0x6 && (ebx & bit_AVX2)) features |= CPU_AVX2;
+    if ((xcr0 & 0xe6) == 0xe6) {
+      if (ebx & bit_AVX512F) features |= CPU_AVX512F;
+      if (ebx & bit_AVX512BW) features |= CPU_AVX512BW;
+    }
+  }
+  return features;
+}
+
+#else
+
+static unsigned detect(void) { return 0; }
+
+#endif
+
+static unsigned host_features;
+static enum CPU_tier tier = CPU_TIER_AVX512;
+static int detected;
+
+#define MAX_MODULES 16
+static void (*modules[MAX_MODULES])(void);
+static int num_modules;
+
+static void detect_once(void) {
+  if (detected) {
+    return;
+  }
+  detected = 1;
+  host_features = detect();
+  const char* name = getenv("CRYPTOPALS_CPU");
+  if (name != NULL && !CPU_parse_tier(name, &tier)) {
+    // this runs from constructors, before main() could report it
+    fprintf(stderr,
+            "ignoring unknown CRYPTOPALS_CPU tier \"%s\" (expected scalar, "
+            "sse, avx2 or avx512)\n",
+            name);
+    tier = CPU_TIER_AVX512;
+  }
+}
+
+unsigned CPU_features(void) {
+  detect_once();
+  return host_features & tier_features[tier];
+}
+
+int CPU_has(unsigned features) {
+  return (CPU_features() & features) == features;
+}
+
+enum CPU_tier CPU_get_tier(void) {
+  detect_once();
+  return tier;
+}
+
+void CPU_set_tier(enum CPU_tier t) {
+  detect_once();
+  tier = t;
+  for (int i = 0; i < num_modules; i++) {
+    modules[i]();
+  }
+}
+
+int CPU_parse_tier(const char* name, enum CPU_tier* t) {
+  for (int i = 0; i <= CPU_TIER_AVX512; i++) {
+    if (strcmp(name, tier_names[i]) == 0) {
+      *t = (enum CPU_tier)i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+const char* CPU_tier_name(enum CPU_tier t) {
+  return tier_names[t];
+}
+
+void CPU_register(void (*bind)(void)) {
+  assert(num_modules < MAX_MODULES);
+  modules[num_modules++] = bind;
+  bind();
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+// CPU feature detection and kernel dispatch shared by every module with ISA
+// specific code. The build doesn't assume any particular ISA: kernels are
+// compiled for their instruction sets with target attributes, and each module
+// binds its function pointers from CPU_features() at startup, so one binary
+// runs the fastest code each host supports.
+//
+// The features in use can be capped at a tier, to benchmark or test the
+// slower code on a fast machine: set CRYPTOPALS_CPU to a tier name before
+// starting (an unknown name gets a warning on stderr and no cap), or call
+// CPU_set_tier() (which --cpu does).
+
+#ifndef _CPU_H_
+#define _CPU_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum CPU_feature {
+  CPU_SSSE3 = 1 << 0,
+  CPU_SSE41 = 1 << 1,
+  CPU_POPCNT = 1 << 2,
+  CPU_AESNI = 1 << 3,
+  CPU_PCLMUL = 1 << 4,
+  CPU_AVX2 = 1 << 5,
+  CPU_AVX512F = 1 << 6,
+  CPU_AVX512BW = 1 << 7,
+};
+
+// Each tier allows the features of the one before it, plus:
+enum CPU_tier {
+  CPU_TIER_SCALAR = 0,  // nothing: portable C only
+  CPU_TIER_SSE = 1,     // SSSE3, SSE4.1, POPCNT, AES-NI and PCLMUL
+  CPU_TIER_AVX2 = 2,    // AVX2
+  CPU_TIER_AVX512 = 3,  // AVX-512 F and BW, i.e. everything
+};
+
+// The CPU_feature bits the host supports (including OS support for the
+// register state), limited to the current tier. Detection happens once.
+unsigned CPU_features(void);
+
+// Returns non-zero if all of the given features can be used.
+int CPU_has(unsigned features);
+
+enum CPU_tier CPU_get_tier(void);
+
+// Limit kernels to a tier, and rebind every module's kernels to match. This
+// must not race with calls into the kernels. AES keys that are already
+// expanded keep their backend (see AesKey in aes_cipher.h).
+void CPU_set_tier(enum CPU_tier tier);
+
+// Tier names are "scalar", "sse", "avx2" and "avx512". Returns 0 if name
+// isn't one of them.
+int CPU_parse_tier(const char* name, enum CPU_tier* tier);
+const char* CPU_tier_name(enum CPU_tier tier);
+
+// Modules call this from a constructor with a function that binds their
+// kernels based on CPU_features(). It's called right away, and again every
+// time the tier changes.
+void CPU_register(void (*bind)(void));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_CPU_H_
@@ -0,0 +1,415 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+#include "./dictionary.h"
+
+#include <ctype.h>
+#include <endian.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+namespace cryptopals {
+
+static const char dictionary_magic[8] = {'C', 'P', 'W', 'O', 'R', 'D', 'S', 0};
+static const size_t header_size = 64;
+static const size_t block_size = 64;
+static const size_t slot_size = 16;
+static const size_t prefix_size = 10;
+static const size_t max_word_size = 0xffff;
+
+// Bloom filter bits set per word, and bits of filter per word; about 1% of
+// the words that aren't there get past it.
+static const int bloom_probes = 7;
+static const size_t bloom_bits_per_word = 10;
+
+// average words per bucket, how long to look for a bucket's seed before
+// trying another salt, and how many salts to try before giving up
+static const size_t bucket_load = 4;
+static const uint32_t max_seed = 1 << 20;
+static const uint64_t max_salts = 16;
+
+// the index is little-endian whatever the host is
+static inline uint64_t load_u64(const char *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return le64toh(v);
+}
+
+static inline uint32_t load_u32(const char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return le32toh(v);
+}
+
+static inline uint16_t load_u16(const char *p) {
+  uint16_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return le16toh(v);
+}
+
+static inline uint64_t to_le(uint64_t v) { return htole64(v); }
+static inline uint32_t to_le(uint32_t v) { return htole32(v); }
+static inline uint16_t to_le(uint16_t v) { return htole16(v); }
+
+template <typename T>
+static inline void store(std::vector<char> *image, size_t offset, T v) {
+  v = to_le(v);
+  std::memcpy(image->data() + offset, &v, sizeof(v));
+}
+
+// the 64 bit finalizer from MurmurHash3
+static inline uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// What a lookup needs to know about a word: h picks its bucket and, with
+// the bucket's seed, its slot; g picks its Bloom filter block and bits.
+struct WordHash {
+  uint64_t h;
+  uint64_t g;
+};
+
+// from the FNV-1a hash of the word's letters
+static inline WordHash finish_hash(uint64_t fnv) {
+  const uint64_t h = mix(fnv);
+  return {h, mix(h + 0x9e3779b97f4a7c15ULL)};
+}
+
+static inline WordHash hash_word(std::string_view word, uint64_t salt) {
+  uint64_t h = Dictionary::kHashBasis ^ salt;
+  for (char c : word) {
+    h = Dictionary::hash_step(h, c);
+  }
+  return finish_hash(h);
+}
+
+// a 32 bit hash scaled to [0, n) without a division
+static inline uint64_t scale(uint64_t x, uint64_t n) {
+  return (x & 0xffffffff) * n >> 32;
+}
+
+static inline uint64_t bucket_of(const WordHash &hash, uint64_t buckets) {
+  return scale(hash.h >> 32, buckets);
+}
+
+static inline uint64_t slot_of(const WordHash &hash, uint32_t seed,
+                               uint64_t slots) {
+  return ((hash.h & 0xffffffff) + seed * ((hash.g & 0xffffffff) | 1)) % slots;
+}
+
+static inline uint64_t block_of(const WordHash &hash, uint64_t blocks) {
+  return scale(hash.g >> 32, blocks);
+}
+
+// the j-th bit of its Bloom filter block that a word sets, from bits =
+// mix(hash.g)
+static inline unsigned bloom_bit(uint64_t bits, int j) {
+  return (bits >> (9 * j)) & (block_size * 8 - 1);
+}
+
+// The line in lowercase, or false if it has anything but letters; such a
+// line can't match a word of text.
+static bool normalize(const std::string &line, std::string *word) {
+  if (line.empty() || line.size() > max_word_size) return false;
+  word->clear();
+  for (char c : line) {
+    const int lower = tolower(static_cast<unsigned char>(c));
+    if (lower < 'a' || lower > 'z') return false;
+    word->push_back(static_cast<char>(lower));
+  }
+  return true;
+}
+
+static std::vector<std::string> read_words(std::istream &in) {
+  std::vector<std::string> words;
+  std::string line, word;
+  while (std::getline(in, line)) {
+    if (normalize(line, &word)) words.push_back(word);
+  }
+  return words;
+}
+
+struct HashedWord {
+  WordHash hash;
+  const std::string *word;
+};
+
+// Hash the words with salt and sort them by hash, which puts the words of
+// each bucket together and copies of a word next to each other; the copies
+// are dropped. Returns false if two different words hash the same.
+static bool hash_words(const std::vector<std::string> &words, uint64_t salt,
+                       std::vector<HashedWord> *hashed) {
+  hashed->clear();
+  for (const std::string &word : words) {
+    hashed->push_back({hash_word(word, salt), &word});
+  }
+  std::sort(hashed->begin(), hashed->end(),
+            [](const HashedWord &a, const HashedWord &b) {
+              return a.hash.h != b.hash.h ? a.hash.h < b.hash.h
+                                          : a.hash.g < b.hash.g;
+            });
+  size_t kept = 0;
+  for (const HashedWord &word : *hashed) {
+    if (kept && word.hash.h == (*hashed)[kept - 1].hash.h &&
+        word.hash.g == (*hashed)[kept - 1].hash.g) {
+      if (*word.word != *(*hashed)[kept - 1].word) return false;
+      continue;
+    }
+    (*hashed)[kept++] = word;
+  }
+  hashed->resize(kept);
+  return true;
+}
+
+// Find a seed for every bucket that sends its words to free slots, biggest
+// buckets first while there's the most room. slot_words gets the index of
+// the word in each slot, or -1.
+static bool place(const std::vector<HashedWord> &hashed, uint64_t buckets,
+                  uint64_t slots, std::vector<uint32_t> *seeds,
+                  std::vector<int64_t> *slot_words) {
+  // bucket b has the words from start[b] up to start[b + 1]
+  std::vector<uint32_t> start(buckets + 1);
+  for (const HashedWord &word : hashed) {
+    start[bucket_of(word.hash, buckets) + 1]++;
+  }
+  for (uint64_t b = 0; b < buckets; b++) {
+    start[b + 1] += start[b];
+  }
+  std::vector<uint32_t> order(buckets);
+  for (uint32_t b = 0; b < buckets; b++) {
+    order[b] = b;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return start[a + 1] - start[a] > start[b + 1] - start[b];
+  });
+
+  seeds->assign(buckets, 0);
+  slot_words->assign(slots, -1);
+  std::vector<uint64_t> chosen;
+  for (uint32_t b : order) {
+    const uint32_t first = start[b], last = start[b + 1];
+    if (first == last) break;
+    uint32_t seed = 0;
+    for (; seed < max_seed; seed++) {
+      chosen.clear();
+      for (uint32_t i = first; i < last; i++) {
+        const uint64_t slot = slot_of(hashed[i].hash, seed, slots);
+        if ((*slot_words)[slot] != -1 ||
+            std::find(chosen.begin(), chosen.end(), slot) != chosen.end()) {
+          break;
+        }
+        chosen.push_back(slot);
+      }
+      if (chosen.size() == last - first) break;
+    }
+    if (seed == max_seed) return false;
+    (*seeds)[b] = seed;
+    for (size_t i = 0; i < chosen.size(); i++) {
+      (*slot_words)[chosen[i]] = first + i;
+    }
+  }
+  return true;
+}
+
+// Compile words into an index image. Returns false if no salt up to
+// max_salts gives a perfect hash, which shouldn't happen for real word lists.
+static bool compile(const std::vector<std::string> &words,
+                    std::vector<char> *image) {
+  // a salt only needs changing if two words hash the same, so this is
+  // nearly always the first
+  uint64_t salt = 0, count = 0, buckets = 0, slots = 0, blocks = 0;
+  std::vector<HashedWord> hashed;
+  std::vector<uint32_t> seeds;
+  std::vector<int64_t> slot_words;
+  for (; salt < max_salts; salt++) {
+    if (!hash_words(words, salt, &hashed)) continue;
+    count = hashed.size();
+    buckets = count / bucket_load + 1;
+    slots = count + count / 50 + 1;
+    blocks = count * bloom_bits_per_word / (block_size * 8) + 1;
+    if (place(hashed, buckets, slots, &seeds, &slot_words)) break;
+  }
+  if (salt == max_salts) return false;
+
+  std::vector<uint64_t> text_offsets;
+  uint64_t text_size = 0;
+  for (const HashedWord &word : hashed) {
+    text_offsets.push_back(text_size);
+    text_size += word.word->size();
+  }
+  const size_t slots_offset = header_size + blocks * block_size;
+  const size_t seeds_offset = slots_offset + slots * slot_size;
+  const size_t text_offset = seeds_offset + (buckets * 4 + 7) / 8 * 8;
+  image->assign(text_offset + text_size, 0);
+
+  std::memcpy(image->data(), dictionary_magic, sizeof(dictionary_magic));
+  const uint64_t header[] = {salt, count, buckets, slots, blocks, text_size};
+  for (size_t i = 0; i < 6; i++) {
+    store(image, sizeof(dictionary_magic) + i * 8, header[i]);
+  }
+  for (size_t i = 0; i < count; i++) {
+    const std::string &word = *hashed[i].word;
+    char *block = image->data() + header_size +
+                  block_of(hashed[i].hash, blocks) * block_size;
+    const uint64_t bits = mix(hashed[i].hash.g);
+    for (int j = 0; j < bloom_probes; j++) {
+      const unsigned bit = bloom_bit(bits, j);
+      block[bit / 8] |= 1 << (bit % 8);
+    }
+    std::memcpy(image->data() + text_offset + text_offsets[i], word.data(),
+                word.size());
+  }
+  for (uint64_t slot = 0; slot < slots; slot++) {
+    if (slot_words[slot] == -1) continue;
+    const size_t i = slot_words[slot];
+    const std::string &word = *hashed[i].word;
+    const size_t offset = slots_offset + slot * slot_size;
+    store(image, offset, static_cast<uint32_t>(text_offsets[i]));
+    store(image, offset + 4, static_cast<uint16_t>(word.size()));
+    std::memcpy(image->data() + offset + 6, word.data(),
+                std::min(word.size(), prefix_size));
+  }
+  for (uint64_t b = 0; b < buckets; b++) {
+    store(image, seeds_offset + b * 4, seeds[b]);
+  }
+  return true;
+}
+
+bool write_dictionary(const std::string &in_path, const std::string &out_path) {
+  std::ifstream infile(in_path);
+  if (!infile) return false;
+  std::vector<char> image;
+  if (!compile(read_words(infile), &image)) return false;
+
+  std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+  if (!out) return false;
+  out.write(image.data(), image.size());
+  return static_cast<bool>(out);
+}
+
+Dictionary::Dictionary() : Dictionary(std::string()) {}
+
+Dictionary::Dictionary(const std::string &path)
+    : file_(path), data_(nullptr), bytes_(0), size_(0), salt_(0) {
+  open(file_.data(), file_.size());
+}
+
+std::unique_ptr<Dictionary> Dictionary::build(const std::string &path) {
+  std::unique_ptr<Dictionary> dict(new Dictionary());
+  std::ifstream infile(path);
+  if (!compile(read_words(infile), &dict->image_)) {
+    compile({}, &dict->image_);
+  }
+  const bool ok = dict->open(dict->image_.data(), dict->image_.size());
+  assert(ok);
+  (void)ok;
+  return dict;
+}
+
+bool Dictionary::open(const char *data, size_t size) {
+  if (size < header_size ||
+      std::memcmp(data, dictionary_magic, sizeof(dictionary_magic)) != 0) {
+    return false;
+  }
+  const char *header = data + sizeof(dictionary_magic);
+  const uint64_t count = load_u64(header + 8);
+  const uint64_t buckets = load_u64(header + 16);
+  const uint64_t slots = load_u64(header + 24);
+  const uint64_t blocks = load_u64(header + 32);
+  const uint64_t text_size = load_u64(header + 40);
+
+  // every section has to fit, without overflowing along the way
+  if (!buckets || !slots || !blocks || buckets > size / 4 ||
+      slots > size / slot_size || blocks > size / block_size ||
+      text_size > size) {
+    return false;
+  }
+  const uint64_t slots_offset = header_size + blocks * block_size;
+  const uint64_t seeds_offset = slots_offset + slots * slot_size;
+  const uint64_t text_offset = seeds_offset + (buckets * 4 + 7) / 8 * 8;
+  if (text_offset + text_size != size) return false;
+
+  salt_ = load_u64(header);
+  buckets_ = buckets;
+  slots_ = slots;
+  blocks_ = blocks;
+  text_size_ = text_size;
+  bloom_ = data + header_size;
+  slot_table_ = data + slots_offset;
+  seeds_ = data + seeds_offset;
+  text_ = data + text_offset;
+  data_ = data;
+  bytes_ = size;
+  size_ = count;
+  return true;
+}
+
+bool Dictionary::contains(std::string_view word) const {
+  if (word.empty()) return false;
+  uint64_t hash = hash_start();
+  for (char c : word) {
+    hash = hash_step(hash, c);
+  }
+  return contains(hash, word);
+}
+
+bool Dictionary::contains(uint64_t fnv, std::string_view text) const {
+  if (!valid()) return false;
+  const WordHash hash = finish_hash(fnv);
+
+  const char *block = bloom_ + block_of(hash, blocks_) * block_size;
+  const uint64_t bits = mix(hash.g);
+  for (int j = 0; j < bloom_probes; j++) {
+    const unsigned bit = bloom_bit(bits, j);
+    if (!(block[bit / 8] & (1 << (bit % 8)))) return false;
+  }
+
+  const uint32_t seed = load_u32(seeds_ + bucket_of(hash, buckets_) * 4);
+  const char *slot = slot_table_ + slot_of(hash, seed, slots_) * slot_size;
+  const size_t length = load_u16(slot + 4);
+  if (length == 0) return false;  // a free slot
+  const char *letters = slot + 6;
+  if (length > prefix_size) {
+    // the slot isn't trusted to point inside the text
+    const uint64_t offset = load_u32(slot);
+    if (offset + length > text_size_) return false;
+    letters = text_ + offset;
+  }
+
+  size_t i = 0;
+  for (char c : text) {
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    if (c < 'a' || c > 'z') continue;
+    if (i == length || letters[i] != c) return false;
+    i++;
+  }
+  return i == length;
+}
+
+void Dictionary::prefault() const {
+  volatile char sink = 0;
+  for (size_t i = 0; i < bytes_; i += 4096) {
+    sink = sink + data_[i];
+  }
+}
+}  // namespace cryptopals
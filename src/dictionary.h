@@ -0,0 +1,112 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./mapped_file.h"
+
+namespace cryptopals {
+
+// The word list score_text() checks words against, compiled into an index
+// that's used in place from a mapping. Words are stored as lowercase letters
+// and looked up by hashing them directly. The layout is little-endian:
+//
+//   header  "CPWORDS\0", then uint64 hash salt, word count, bucket count,
+//           slot count, Bloom filter block count and text size
+//   bloom   64 byte blocks; a word sets 7 bits in one of them
+//   slots   16 bytes each: uint32 offset of the word in text, uint16 length,
+//           and the first 10 letters
+//   seeds   uint32 per bucket, zero padded to 8 bytes
+//   text    the words, back to back
+//
+// The header is 64 bytes, so each Bloom filter block is one cache line. A
+// word's bucket seed picks its slot, and no two words share one. Most words
+// that aren't there stop at the filter, one cache line; a hit reads three,
+// for the filter block, the seed and the slot, plus the text for words
+// longer than 10 letters.
+//
+// Lines of a word list that are all letters are kept in lowercase. Other
+// lines (e.g. "don't") can't match a word of text and are dropped.
+
+// Compile the word list at in_path, one word per line, into an index at
+// out_path. Returns false if either file can't be opened, or in the unlikely
+// case that the perfect hash can't be built.
+bool write_dictionary(const std::string &in_path, const std::string &out_path);
+
+class Dictionary {
+ public:
+  // A file that's missing or isn't a well formed index opens as invalid, and
+  // then contains nothing.
+  explicit Dictionary(const std::string &path);
+  Dictionary(const Dictionary &other) = delete;
+
+  // Compile the word list at path in memory, for when there's no index on
+  // disk. A missing list, or one write_dictionary() would fail on, gives an
+  // empty, valid dictionary.
+  static std::unique_ptr<Dictionary> build(const std::string &path);
+
+  inline bool valid() const { return data_ != nullptr; }
+  inline size_t size() const { return size_; }
+
+  // word is lowercase letters
+  bool contains(std::string_view word) const;
+
+  // Words can also be hashed a letter at a time while text is scanned: start
+  // with hash_start(), add each letter in lowercase with hash_step(), and
+  // look the result up here. text is where the word came from, in any case
+  // and with anything that isn't a letter skipped; it's only read if the
+  // Bloom filter lets the word through.
+  bool contains(uint64_t hash, std::string_view text) const;
+
+  inline uint64_t hash_start() const { return kHashBasis ^ salt_; }
+  static inline uint64_t hash_step(uint64_t hash, char letter) {
+    return (hash ^ static_cast<uint8_t>(letter)) * kHashPrime;
+  }
+
+  // FNV-1a, salted by the index
+  static constexpr uint64_t kHashBasis = 0xcbf29ce484222325ULL;
+  static constexpr uint64_t kHashPrime = 0x100000001b3ULL;
+
+  // Read every page of the index, so that lookups don't fault them in.
+  void prefault() const;
+
+ private:
+  Dictionary();
+  bool open(const char *data, size_t size);
+
+  MappedFile file_;
+  std::vector<char> image_;  // the index, when it was built in memory
+  const char *data_;
+  size_t bytes_;
+  size_t size_;
+  uint64_t salt_;
+  uint64_t buckets_;
+  uint64_t slots_;
+  uint64_t blocks_;
+  uint64_t text_size_;
+  const char *bloom_;
+  const char *slot_table_;
+  const char *seeds_;
+  const char *text_;
+};
+}  // namespace cryptopals
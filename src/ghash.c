@@ -0,0 +1,238 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "ghash.h"
+
+#include <string.h>
+
+#include "cpu.h"
+
+static uint64_t load64_be(const uint8_t* p) {
+  uint64_t x = 0;
+  for (unsigned i = 0; i < 8; i++) {
+    x = (x << 8) | p[i];
+  }
+  return x;
+}
+
+static void store64_be(uint8_t* p, uint64_t x) {
+  for (unsigned i = 0; i < 8; i++) {
+    p[i] = (uint8_t)(x >> (56 - 8 * i));
+  }
+}
+
+// Reduction of the four bits shifted out by each step of gmult_4bit.
+static const uint64_t last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0};
+
+static void init_4bit(struct GHASH_ctx* ctx, const uint8_t* H) {
+  uint64_t vh = load64_be(H);
+  uint64_t vl = load64_be(H + 8);
+
+  // H times 8, 4, 2 and 1 (GCM bit order is reversed, so multiplying by x
+  // is a right shift)
+  ctx->HH[8] = vh;
+  ctx->HL[8] = vl;
+  for (unsigned i = 4; i > 0; i >>= 1) {
+    const uint64_t t = (vl & 1) * 0xe100000000000000ULL;
+    vl = (vh << 63) | (vl >> 1);
+    vh = (vh >> 1) ^ t;
+    ctx->HH[i] = vh;
+    ctx->HL[i] = vl;
+  }
+  ctx->HH[0] = 0;
+  ctx->HL[0] = 0;
+
+  // everything else is a sum of those
+  for (unsigned i = 2; i <= 8; i *= 2) {
+    for (unsigned j = 1; j < i; j++) {
+      ctx->HH[i + j] = ctx->HH[i] ^ ctx->HH[j];
+      ctx->HL[i + j] = ctx->HL[i] ^ ctx->HL[j];
+    }
+  }
+}
+
+// Y = Y * H, a nibble at a time from the end.
+static void gmult_4bit(const struct GHASH_ctx* ctx, uint8_t* Y) {
+  uint64_t zh = 0, zl = 0;
+  for (int i = GHASH_BLOCKLEN - 1; i >= 0; i--) {
+    const uint8_t nibbles[2] = {(uint8_t)(Y[i] & 0xf), (uint8_t)(Y[i] >> 4)};
+    for (unsigned n = 0; n < 2; n++) {
+      if (i != GHASH_BLOCKLEN - 1 || n != 0) {
+        const uint8_t rem = zl & 0xf;
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (last4[rem] << 48);
+      }
+      zh ^= ctx->HH[nibbles[n]];
+      zl ^= ctx->HL[nibbles[n]];
+    }
+  }
+  store64_be(Y, zh);
+  store64_be(Y + 8, zl);
+}
+
+static void update_4bit(const struct GHASH_ctx* ctx, uint8_t* Y,
+                        const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i += GHASH_BLOCKLEN) {
+    for (unsigned j = 0; j < GHASH_BLOCKLEN; j++) {
+      Y[j] ^= data[i + j];
+    }
+    gmult_4bit(ctx, Y);
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+#define CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+
+int GHASH_clmul_supported(void) {
+  return CPU_has(CPU_PCLMUL | CPU_SSSE3);
+}
+
+CLMUL_TARGET static inline __m128i bswap128(__m128i x) {
+  const __m128i mask =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return _mm_shuffle_epi8(x, mask);
+}
+
+// 128x128 -> 256 bit carry-less multiply, without reduction.
+CLMUL_TARGET static inline void clmul(__m128i a, __m128i b, __m128i* lo,
+                                      __m128i* hi) {
+  __m128i t0 = _mm_clmulepi64_si128(a, b, 0x00);
+  __m128i t1 = _mm_clmulepi64_si128(a, b, 0x10);
+  __m128i t2 = _mm_clmulepi64_si128(a, b, 0x01);
+  __m128i t3 = _mm_clmulepi64_si128(a, b, 0x11);
+  t1 = _mm_xor_si128(t1, t2);
+  *lo = _mm_xor_si128(t0, _mm_slli_si128(t1, 8));
+  *hi = _mm_xor_si128(t3, _mm_srli_si128(t1, 8));
+}
+
+// Reduce a 256 bit product modulo the GCM polynomial. Because the operands
+// are bit-reflected the product is first shifted left by one. Both steps are
+// linear, so a sum of several products only needs to be reduced once.
+CLMUL_TARGET static inline __m128i reduce(__m128i lo, __m128i hi) {
+  __m128i t7 = _mm_srli_epi32(lo, 31);
+  __m128i t8 = _mm_srli_epi32(hi, 31);
+  lo = _mm_slli_epi32(lo, 1);
+  hi = _mm_slli_epi32(hi, 1);
+  __m128i t9 = _mm_srli_si128(t7, 12);
+  t8 = _mm_slli_si128(t8, 4);
+  t7 = _mm_slli_si128(t7, 4);
+  lo = _mm_or_si128(lo, t7);
+  hi = _mm_or_si128(hi, t8);
+  hi = _mm_or_si128(hi, t9);
+
+  t7 = _mm_slli_epi32(lo, 31);
+  t8 = _mm_slli_epi32(lo, 30);
+  t9 = _mm_slli_epi32(lo, 25);
+  t7 = _mm_xor_si128(t7, t8);
+  t7 = _mm_xor_si128(t7, t9);
+  t8 = _mm_srli_si128(t7, 4);
+  t7 = _mm_slli_si128(t7, 12);
+  lo = _mm_xor_si128(lo, t7);
+
+  __m128i t2 = _mm_srli_epi32(lo, 1);
+  __m128i t4 = _mm_srli_epi32(lo, 2);
+  __m128i t5 = _mm_srli_epi32(lo, 7);
+  t2 = _mm_xor_si128(t2, t4);
+  t2 = _mm_xor_si128(t2, t5);
+  t2 = _mm_xor_si128(t2, t8);
+  lo = _mm_xor_si128(lo, t2);
+  return _mm_xor_si128(hi, lo);
+}
+
+CLMUL_TARGET static inline __m128i gfmul(__m128i a, __m128i b) {
+  __m128i lo, hi;
+  clmul(a, b, &lo, &hi);
+  return reduce(lo, hi);
+}
+
+CLMUL_TARGET static void init_clmul(struct GHASH_ctx* ctx, const uint8_t* H) {
+  const __m128i h = bswap128(_mm_loadu_si128((const __m128i*)H));
+  __m128i p = h;
+  _mm_storeu_si128((__m128i*)ctx->Hpow[0], p);
+  for (unsigned i = 1; i < 4; i++) {
+    p = gfmul(p, h);
+    _mm_storeu_si128((__m128i*)ctx->Hpow[i], p);
+  }
+}
+
+CLMUL_TARGET static void update_clmul(const struct GHASH_ctx* ctx, uint8_t* Y,
+                                      const uint8_t* data, size_t len) {
+  const __m128i h1 = _mm_loadu_si128((const __m128i*)ctx->Hpow[0]);
+  const __m128i h2 = _mm_loadu_si128((const __m128i*)ctx->Hpow[1]);
+  const __m128i h3 = _mm_loadu_si128((const __m128i*)ctx->Hpow[2]);
+  const __m128i h4 = _mm_loadu_si128((const __m128i*)ctx->Hpow[3]);
+  __m128i y = bswap128(_mm_loadu_si128((const __m128i*)Y));
+  size_t i = 0;
+
+  // Y' = (Y ^ X1) H^4 ^ X2 H^3 ^ X3 H^2 ^ X4 H, with a single reduction
+  for (; i + 4 * GHASH_BLOCKLEN <= len; i += 4 * GHASH_BLOCKLEN) {
+    const __m128i* x = (const __m128i*)(data + i);
+    __m128i lo, hi, l, h;
+    clmul(_mm_xor_si128(y, bswap128(_mm_loadu_si128(x))), h4, &lo, &hi);
+    clmul(bswap128(_mm_loadu_si128(x + 1)), h3, &l, &h);
+    lo = _mm_xor_si128(lo, l);
+    hi = _mm_xor_si128(hi, h);
+    clmul(bswap128(_mm_loadu_si128(x + 2)), h2, &l, &h);
+    lo = _mm_xor_si128(lo, l);
+    hi = _mm_xor_si128(hi, h);
+    clmul(bswap128(_mm_loadu_si128(x + 3)), h1, &l, &h);
+    lo = _mm_xor_si128(lo, l);
+    hi = _mm_xor_si128(hi, h);
+    y = reduce(lo, hi);
+  }
+  for (; i < len; i += GHASH_BLOCKLEN) {
+    const __m128i x = bswap128(_mm_loadu_si128((const __m128i*)(data + i)));
+    y = gfmul(_mm_xor_si128(y, x), h1);
+  }
+  _mm_storeu_si128((__m128i*)Y, bswap128(y));
+}
+
+#else
+
+int GHASH_clmul_supported(void) { return 0; }
+
+#endif
+
+void GHASH_init(struct GHASH_ctx* ctx, const uint8_t* H, int use_clmul) {
+  memset(ctx, 0, sizeof(*ctx));
+  init_4bit(ctx, H);
+#if defined(__x86_64__) || defined(__i386__)
+  if (use_clmul) {
+    ctx->use_clmul = 1;
+    init_clmul(ctx, H);
+  }
+#else
+  (void)use_clmul;
+#endif
+}
+
+void GHASH_update(const struct GHASH_ctx* ctx, uint8_t* Y, const uint8_t* data,
+                  size_t len) {
+#if defined(__x86_64__) || defined(__i386__)
+  if (ctx->use_clmul) {
+    update_clmul(ctx, Y, data, len);
+    return;
+  }
+#endif
+  update_4bit(ctx, Y, data, len);
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+// GHASH, the universal hash used by GCM. With PCLMULQDQ this uses carry-less
+// multiplication and reduces once per 4 blocks; otherwise it falls back to
+// Shoup's 4-bit table method.
+
+#ifndef _GHASH_H_
+#define _GHASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GHASH_BLOCKLEN 16
+
+struct GHASH_ctx {
+  // 4-bit tables: HH[i]:HL[i] is the product of H and the nibble i
+  uint64_t HH[16];
+  uint64_t HL[16];
+  // byte-reflected H, H^2, H^3, H^4 for the PCLMULQDQ code
+  uint8_t Hpow[4][GHASH_BLOCKLEN];
+  int use_clmul;
+};
+
+// Returns non-zero if the CPU supports PCLMULQDQ (and SSSE3, which is needed
+// to byte swap).
+int GHASH_clmul_supported(void);
+
+// Set up the hash key H, which for GCM is the encryption of the zero block.
+// use_clmul picks the implementation; pass GHASH_clmul_supported().
+void GHASH_init(struct GHASH_ctx* ctx, const uint8_t* H, int use_clmul);
+
+// Y = (Y ^ X) * H for each block X of data. len must be a multiple of
+// GHASH_BLOCKLEN.
+void GHASH_update(const struct GHASH_ctx* ctx, uint8_t* Y, const uint8_t* data,
+                  size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_GHASH_H_
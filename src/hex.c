@@ -0,0 +1,232 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "hex.h"
+
+#include "cpu.h"
+
+static const char hex_digits[] = "0123456789abcdef";
+
+// hex digit value of each character, or -1
+static int8_t hex_values[256];
+
+static void encode_scalar(const uint8_t* in, size_t len, char* out) {
+  for (size_t i = 0; i < len; i++) {
+    out[2 * i] = hex_digits[in[i] >> 4];
+    out[2 * i + 1] = hex_digits[in[i] & 0xf];
+  }
+}
+
+static int decode_scalar(const char* in, size_t len, uint8_t* out) {
+  int8_t bad = 0;
+  for (size_t i = 0; i < len / 2; i++) {
+    const int8_t hi = hex_values[(uint8_t)in[2 * i]];
+    const int8_t lo = hex_values[(uint8_t)in[2 * i + 1]];
+    bad |= hi | lo;
+    out[i] = (uint8_t)(((uint8_t)hi << 4) | (lo & 0xf));
+  }
+  return bad >= 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+SSSE3_TARGET static void encode_ssse3(const uint8_t* in, size_t len,
+                                      char* out) {
+  const __m128i lut = _mm_loadu_si128((const __m128i*)hex_digits);
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+    const __m128i hi = _mm_shuffle_epi8(
+        lut, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+    const __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+    _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i*)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+  encode_scalar(in + i, len - i, out + 2 * i);
+}
+
+// Turn 16 hex digits into their values, clearing *valid if any aren't hex
+// digits.
+SSSE3_TARGET static inline __m128i nibbles_ssse3(__m128i v, __m128i* valid) {
+  // '0'-'9' and 'a'-'f'/'A'-'F' are each a contiguous range; check both with
+  // unsigned min, since there's no unsigned compare
+  const __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+  const __m128i letter =
+      _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  const __m128i is_digit =
+      _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  const __m128i is_letter =
+      _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+  *valid = _mm_and_si128(*valid, _mm_or_si128(is_digit, is_letter));
+  return _mm_or_si128(
+      _mm_and_si128(is_digit, digit),
+      _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+SSSE3_TARGET static int decode_ssse3(const char* in, size_t len, uint8_t* out) {
+  // each pair of nibbles becomes hi * 16 + lo in a 16-bit lane
+  const __m128i weights = _mm_set1_epi16(0x0110);
+  __m128i valid = _mm_set1_epi8(-1);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    const __m128i a = nibbles_ssse3(
+        _mm_loadu_si128((const __m128i*)(in + i)), &valid);
+    const __m128i b = nibbles_ssse3(
+        _mm_loadu_si128((const __m128i*)(in + i + 16)), &valid);
+    const __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(a, weights),
+                                           _mm_maddubs_epi16(b, weights));
+    _mm_storeu_si128((__m128i*)(out + i / 2), bytes);
+  }
+  const int ok = _mm_movemask_epi8(valid) == 0xffff;
+  return decode_scalar(in + i, len - i, out + i / 2) && ok;
+}
+
+AVX2_TARGET static void encode_avx2(const uint8_t* in, size_t len, char* out) {
+  const __m256i lut = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)hex_digits));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+    const __m256i hi = _mm256_shuffle_epi8(
+        lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+    const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, mask));
+    // unpacking works within 128-bit lanes, so put the lanes back in order
+    const __m256i a = _mm256_unpacklo_epi8(hi, lo);
+    const __m256i b = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256((__m256i*)(out + 2 * i),
+                        _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256((__m256i*)(out + 2 * i + 32),
+                        _mm256_permute2x128_si256(a, b, 0x31));
+  }
+  encode_ssse3(in + i, len - i, out + 2 * i);
+}
+
+AVX2_TARGET static inline __m256i nibbles_avx2(__m256i v, __m256i* valid) {
+  const __m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+  const __m256i letter = _mm256_sub_epi8(
+      _mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+  const __m256i is_digit =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+  const __m256i is_letter =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+  *valid = _mm256_and_si256(*valid, _mm256_or_si256(is_digit, is_letter));
+  return _mm256_or_si256(
+      _mm256_and_si256(is_digit, digit),
+      _mm256_and_si256(is_letter,
+                       _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+AVX2_TARGET static int decode_avx2(const char* in, size_t len, uint8_t* out) {
+  const __m256i weights = _mm256_set1_epi16(0x0110);
+  __m256i valid = _mm256_set1_epi8(-1);
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    const __m256i a = nibbles_avx2(
+        _mm256_loadu_si256((const __m256i*)(in + i)), &valid);
+    const __m256i b = nibbles_avx2(
+        _mm256_loadu_si256((const __m256i*)(in + i + 32)), &valid);
+    // packing also works within lanes: fix up the 64-bit quarters
+    const __m256i bytes =
+        _mm256_packus_epi16(_mm256_maddubs_epi16(a, weights),
+                            _mm256_maddubs_epi16(b, weights));
+    _mm256_storeu_si256((__m256i*)(out + i / 2),
+                        _mm256_permute4x64_epi64(bytes, 0xd8));
+  }
+  const int ok = (uint32_t)_mm256_movemask_epi8(valid) == 0xffffffffu;
+  return decode_ssse3(in + i, len - i, out + i / 2) && ok;
+}
+
+#endif
+
+static const unsigned impl_features[] = {0, CPU_SSSE3, CPU_AVX2};
+
+static enum HEX_impl impl;
+static void (*encode)(const uint8_t* in, size_t len, char* out);
+static int (*decode)(const char* in, size_t len, uint8_t* out);
+
+static void use_impl(enum HEX_impl i) {
+  impl = i;
+  switch (i) {
+#if defined(__x86_64__) || defined(__i386__)
+    case HEX_IMPL_AVX2:
+      encode = encode_avx2;
+      decode = decode_avx2;
+      break;
+    case HEX_IMPL_SSSE3:
+      encode = encode_ssse3;
+      decode = decode_ssse3;
+      break;
+#endif
+    default:
+      encode = encode_scalar;
+      decode = decode_scalar;
+      break;
+  }
+}
+
+static void bind(void) {
+  enum HEX_impl best = HEX_IMPL_SCALAR;
+  if (CPU_has(CPU_AVX2)) {
+    best = HEX_IMPL_AVX2;
+  } else if (CPU_has(CPU_SSSE3)) {
+    best = HEX_IMPL_SSSE3;
+  }
+  use_impl(best);
+}
+
+__attribute__((constructor)) static void Init(void) {
+  for (int i = 0; i < 256; i++) {
+    hex_values[i] = -1;
+  }
+  for (int i = 0; i < 16; i++) {
+    hex_values[(uint8_t)hex_digits[i]] = (int8_t)i;
+    if (i >= 10) {
+      hex_values[(uint8_t)(hex_digits[i] - 'a' + 'A')] = (int8_t)i;
+    }
+  }
+  CPU_register(bind);
+}
+
+enum HEX_impl HEX_get_impl(void) {
+  return impl;
+}
+
+int HEX_set_impl(enum HEX_impl i) {
+  if (!CPU_has(impl_features[i])) {
+    return 0;
+  }
+  use_impl(i);
+  return 1;
+}
+
+void HEX_encode(const uint8_t* in, size_t len, char* out) {
+  encode(in, len, out);
+}
+
+int HEX_decode(const char* in, size_t len, uint8_t* out) {
+  if (len % 2) {
+    return 0;
+  }
+  return decode(in, len, out);
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+// Hex encoding and decoding. Encoding writes lowercase digits; decoding
+// accepts either case and checks every digit. Bulk input goes through AVX2 or
+// SSSE3 kernels (32 or 16 bytes a step) when the CPU has them, with a table
+// driven scalar version for the tail and for other CPUs.
+
+#ifndef _HEX_H_
+#define _HEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum HEX_impl {
+  HEX_IMPL_SCALAR = 0,
+  HEX_IMPL_SSSE3 = 1,
+  HEX_IMPL_AVX2 = 2,
+};
+
+// The best implementation the CPU tier allows is picked at startup, and
+// again whenever the tier changes (see cpu.h).
+enum HEX_impl HEX_get_impl(void);
+
+// Force a particular implementation, e.g. to test them against each other.
+// Returns 0 (and changes nothing) if the CPU tier doesn't allow it.
+int HEX_set_impl(enum HEX_impl impl);
+
+// Write the 2 * len hex digits for in to out. No terminator is added.
+void HEX_encode(const uint8_t* in, size_t len, char* out);
+
+// Decode len (which must be even) hex digits from in into len / 2 bytes at
+// out. Returns 0 if any character isn't a hex digit, in which case out holds
+// garbage; otherwise returns 1.
+int HEX_decode(const char* in, size_t len, uint8_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_HEX_H_
@@ -0,0 +1,98 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "histogram.h"
+
+#include <string.h>
+
+#include "cpu.h"
+
+static void count_scalar(const uint8_t* data, size_t len, size_t* counts) {
+  size_t partial[4][256] = {{0}};
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    partial[0][data[i]]++;
+    partial[1][data[i + 1]]++;
+    partial[2][data[i + 2]]++;
+    partial[3][data[i + 3]]++;
+  }
+  for (; i < len; i++) {
+    partial[0][data[i]]++;
+  }
+  for (int b = 0; b < 256; b++) {
+    counts[b] = partial[0][b] + partial[1][b] + partial[2][b] + partial[3][b];
+  }
+}
+
+// 32-bit counters keep the eight tables in 8 KiB, well inside L1. Each
+// table sees at most an eighth of a chunk, so they can't overflow.
+#define UNROLLED_CHUNK ((size_t)1 << 30)
+
+static void count_unrolled(const uint8_t* data, size_t len, size_t* counts) {
+  memset(counts, 0, 256 * sizeof(size_t));
+  while (len) {
+    const size_t chunk = len < UNROLLED_CHUNK ? len : UNROLLED_CHUNK;
+    uint32_t partial[8][256];
+    memset(partial, 0, sizeof(partial));
+    size_t i = 0;
+    for (; i + 8 <= chunk; i += 8) {
+      partial[0][data[i]]++;
+      partial[1][data[i + 1]]++;
+      partial[2][data[i + 2]]++;
+      partial[3][data[i + 3]]++;
+      partial[4][data[i + 4]]++;
+      partial[5][data[i + 5]]++;
+      partial[6][data[i + 6]]++;
+      partial[7][data[i + 7]]++;
+    }
+    for (; i < chunk; i++) {
+      partial[0][data[i]]++;
+    }
+    for (int b = 0; b < 256; b++) {
+      counts[b] += (size_t)partial[0][b] + partial[1][b] + partial[2][b] +
+                   partial[3][b] + partial[4][b] + partial[5][b] +
+                   partial[6][b] + partial[7][b];
+    }
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+static enum HIST_impl impl;
+static void (*count)(const uint8_t* data, size_t len, size_t* counts);
+
+void HIST_set_impl(enum HIST_impl i) {
+  impl = i;
+  count = i == HIST_IMPL_UNROLLED ? count_unrolled : count_scalar;
+}
+
+static void bind(void) {
+  HIST_set_impl(CPU_get_tier() > CPU_TIER_SCALAR ? HIST_IMPL_UNROLLED
+                                                 : HIST_IMPL_SCALAR);
+}
+
+__attribute__((constructor)) static void Init(void) {
+  CPU_register(bind);
+}
+
+enum HIST_impl HIST_get_impl(void) {
+  return impl;
+}
+
+void HIST_count(const uint8_t* data, size_t len, size_t* counts) {
+  count(data, len, counts);
+}
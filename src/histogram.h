@@ -0,0 +1,53 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+// Byte histograms, which is how single-byte XOR keys are ranked. Counting
+// is bound by the increments of a counter in memory, so the kernels spread
+// the bytes over several tables: a run of one byte (or English text, which
+// is mostly a dozen letters) then doesn't wait on a single counter.
+
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum HIST_impl {
+  HIST_IMPL_SCALAR = 0,    // four tables, a byte at a time
+  HIST_IMPL_UNROLLED = 1,  // eight 32-bit tables, eight bytes at a time
+};
+
+// Both kernels are portable C. The unrolled one is bound above the scalar
+// tier, so that --cpu scalar keeps the simple loop as the baseline; this is
+// redone whenever the tier changes (see cpu.h).
+enum HIST_impl HIST_get_impl(void);
+
+// Force a particular implementation, e.g. to test them against each other.
+void HIST_set_impl(enum HIST_impl impl);
+
+// counts[b] = the number of times b appears in data[0, len), for all 256 b.
+void HIST_count(const uint8_t* data, size_t len, size_t* counts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_HISTOGRAM_H_
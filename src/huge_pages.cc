@@ -0,0 +1,61 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "./huge_pages.h"
+
+#include <sys/mman.h>
+
+#include <cstdint>
+
+namespace cryptopals {
+
+void *huge_pages_alloc(size_t bytes, size_t *mapped) {
+  const size_t size = (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+  *mapped = size;
+
+#ifdef MAP_HUGETLB
+  void *hugetlb = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (hugetlb != MAP_FAILED) return hugetlb;
+#endif
+
+  // Transparent huge pages need 2 MiB alignment, which mmap() doesn't
+  // promise, so map an extra page's worth and trim both ends.
+  const size_t padded = size + kHugePageSize;
+  void *raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) return nullptr;
+  const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+  const uintptr_t aligned =
+      (start + kHugePageSize - 1) & ~uintptr_t(kHugePageSize - 1);
+  if (aligned != start) {
+    munmap(raw, aligned - start);
+  }
+  const uintptr_t end = aligned + size;
+  if (end != start + padded) {
+    munmap(reinterpret_cast<void *>(end), start + padded - end);
+  }
+
+  void *ptr = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+  madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+  return ptr;
+}
+
+void huge_pages_free(void *ptr, size_t mapped) { munmap(ptr, mapped); }
+}  // namespace cryptopals
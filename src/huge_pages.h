@@ -0,0 +1,37 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+
+namespace cryptopals {
+
+// Memory for very large buffers, mapped so the kernel can back it with 2 MiB
+// pages instead of 4 KiB ones. Passes over hundreds of megabytes then take a
+// handful of TLB misses instead of one per 4 KiB.
+constexpr size_t kHugePageSize = 2 << 20;
+
+// Map at least bytes, rounded up to whole huge pages, and return the size
+// that was mapped in *mapped. Explicit hugetlb pages are used if the system
+// has any reserved; otherwise this is a normal mapping aligned for
+// transparent huge pages and madvise()d as such. Returns nullptr on failure.
+void *huge_pages_alloc(size_t bytes, size_t *mapped);
+
+// ptr and mapped must be exactly what huge_pages_alloc() returned.
+void huge_pages_free(void *ptr, size_t mapped);
+}  // namespace cryptopals
@@ -21,14 +21,27 @@
 #include <iostream>
 #include <string>
 
+#include "./bench.h"
+#include "./corpus.h"
+#include "./cpu.h"
+#include "./dictionary.h"
 #include "./problem.h"
 
 inline int retval(int val) { return val == 0 ? 0 : 1; }
 
+static const char usage[] =
+    " [-b|--bench] [-c|--convert FORMAT IN OUT] [-h|--help]"
+    " [-m|--cpu scalar|sse|avx2|avx512] [-x|--stop-on-error]\n";
+
 int main(int argc, char **argv) {
+  bool bench = false;
   bool stop_on_error = false;
-  static const char short_opts[] = "hx";
-  static struct option long_opts[] = {{"help", no_argument, 0, 'h'},
+  const char *convert = nullptr;
+  static const char short_opts[] = "bc:hm:x";
+  static struct option long_opts[] = {{"bench", no_argument, 0, 'b'},
+                                      {"convert", required_argument, 0, 'c'},
+                                      {"help", no_argument, 0, 'h'},
+                                      {"cpu", required_argument, 0, 'm'},
                                       {"stop-on-error", no_argument, 0, 'x'},
                                       {0, 0, 0, 0}};
   for (;;) {
@@ -37,11 +50,26 @@ int main(int argc, char **argv) {
       break;
     }
     switch (c) {
+      case 'b':
+        bench = true;
+        break;
+      case 'c':
+        convert = optarg;
+        break;
       case 'h':
-        std::cout << "usage: " << argv[0]
-                  << " [-h|--help] [-x|--stop-on-error]\n";
+        std::cout << "usage: " << argv[0] << usage;
         return 0;
         break;
+      case 'm': {
+        // cap the kernels at a tier; the default is the best the host has
+        CPU_tier tier;
+        if (!CPU_parse_tier(optarg, &tier)) {
+          std::cerr << "unknown cpu tier: " << optarg << "\n";
+          return 1;
+        }
+        CPU_set_tier(tier);
+        break;
+      }
       case 'x':
         stop_on_error = true;
         break;
@@ -53,6 +81,40 @@ int main(int argc, char **argv) {
         abort();
     }
   }
+  if (bench) {
+    return cryptopals::RunBenchmarks();
+  }
+  if (convert != nullptr) {
+    // turn a text input into a corpus, e.g. hex-lines data/4.txt data/4.bin,
+    // or a word list into a dictionary index
+    const std::string format = convert;
+    if (argc - optind != 2 ||
+        (format != "hex-lines" && format != "base64-lines" &&
+         format != "base64" && format != "words")) {
+      std::cerr << "usage: " << argv[0]
+                << " --convert hex-lines|base64-lines|base64|words IN OUT\n";
+      return 1;
+    }
+    if (format == "words") {
+      if (!cryptopals::write_dictionary(argv[optind], argv[optind + 1])) {
+        std::cerr << "failed to convert " << argv[optind] << "\n";
+        return 1;
+      }
+      return 0;
+    }
+    const cryptopals::TextFormat text_format =
+        format == "hex-lines"
+            ? cryptopals::HEX_LINES
+            : format == "base64-lines" ? cryptopals::BASE64_LINES
+                                       : cryptopals::BASE64_TEXT;
+    if (!cryptopals::write_corpus(argv[optind], text_format,
+                                  argv[optind + 1])) {
+      std::cerr << "failed to convert " << argv[optind] << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
   cryptopals::ProblemManager manager;
   if (argc - optind == 1) {
     unsigned long int set = std::strtoul(argv[optind], nullptr, 10);
@@ -0,0 +1,48 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "./mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cryptopals {
+
+MappedFile::MappedFile(const std::string &path) : data_(nullptr), size_(0) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) return;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) {
+      // the callers read front to back, so have the kernel read ahead
+      madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+      data_ = static_cast<const char *>(ptr);
+      size_ = st.st_size;
+    }
+  }
+  close(fd);  // the mapping stays valid
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+}
+}  // namespace cryptopals
@@ -0,0 +1,41 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace cryptopals {
+
+// A read-only, private mapping of a whole file, for reading big inputs
+// without copying them through a stream first. A file that doesn't exist,
+// is empty or can't be mapped looks empty.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &path);
+  MappedFile(const MappedFile &other) = delete;
+  ~MappedFile();
+
+  inline const char *data() const { return data_; }
+  inline size_t size() const { return size_; }
+
+ private:
+  const char *data_;
+  size_t size_;
+};
+}  // namespace cryptopals
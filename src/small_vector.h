@@ -0,0 +1,222 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "./huge_pages.h"
+
+namespace cryptopals {
+
+// A vector that keeps up to N elements inside the object itself and only
+// goes to the heap past that. This is the subset of the std::vector interface
+// that Buffer uses; elements must be trivially copyable since they're moved
+// around with memcpy. With set_huge_pages(), heap storage of kHugePageSize
+// bytes or more is mapped with huge_pages_alloc() instead.
+template <typename T, size_t N>
+class SmallVector {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SmallVector elements are copied with memcpy");
+
+ public:
+  typedef T value_type;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+
+  SmallVector()
+      : data_(inline_), size_(0), capacity_(N), mapped_(0), huge_(false) {}
+
+  template <typename It>
+  SmallVector(It first, It last) : SmallVector() {
+    insert(end(), first, last);
+  }
+
+  SmallVector(const SmallVector &other) : SmallVector() { *this = other; }
+
+  SmallVector(SmallVector &&other) noexcept : SmallVector() {
+    *this = std::move(other);
+  }
+
+  ~SmallVector() { release(); }
+
+  // The storage policy is copied along with the data.
+  SmallVector &operator=(const SmallVector &other) {
+    if (this != &other) {
+      huge_ = other.huge_;
+      clear();
+      insert(end(), other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  // Heap storage is stolen; inline storage has to be copied.
+  SmallVector &operator=(SmallVector &&other) noexcept {
+    if (this == &other) return *this;
+    huge_ = other.huge_;
+    if (other.is_inline()) {
+      clear();
+      insert(end(), other.begin(), other.end());
+    } else {
+      release();
+      data_ = other.data_;
+      capacity_ = other.capacity_;
+      mapped_ = other.mapped_;
+      size_ = other.size_;
+      other.data_ = other.inline_;
+      other.capacity_ = N;
+      other.mapped_ = 0;
+    }
+    other.size_ = 0;
+    return *this;
+  }
+
+  inline T *data() { return data_; }
+  inline const T *data() const { return data_; }
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0; }
+  inline size_t capacity() const { return capacity_; }
+  inline bool is_inline() const { return data_ == inline_; }
+  inline bool is_huge() const { return mapped_ != 0; }
+
+  // Only affects allocations from here on.
+  inline void set_huge_pages(bool enable) { huge_ = enable; }
+
+  inline iterator begin() { return data_; }
+  inline iterator end() { return data_ + size_; }
+  inline const_iterator begin() const { return data_; }
+  inline const_iterator end() const { return data_ + size_; }
+
+  inline T &operator[](size_t i) { return data_[i]; }
+  inline const T &operator[](size_t i) const { return data_[i]; }
+  inline T &back() { return data_[size_ - 1]; }
+  inline const T &back() const { return data_[size_ - 1]; }
+
+  // val is copied first, in case it's one of this vector's elements
+  inline void push_back(const T &val) {
+    const T copy = val;
+    if (size_ == capacity_) grow(size_ + 1);
+    data_[size_++] = copy;
+  }
+
+  inline void pop_back() {
+    assert(size_);
+    size_--;
+  }
+
+  inline void clear() { size_ = 0; }
+
+  void reserve(size_t n) {
+    if (n > capacity_) grow(n);
+  }
+
+  // new elements are zeroed
+  void resize(size_t n) {
+    reserve(n);
+    if (n > size_) std::memset(data_ + size_, 0, (n - size_) * sizeof(T));
+    size_ = n;
+  }
+
+  // new elements are left uninitialized, for callers about to overwrite them
+  void resize_uninitialized(size_t n) {
+    reserve(n);
+    size_ = n;
+  }
+
+  // The range can point into this vector, e.g. to append part of it to
+  // itself.
+  template <typename It>
+  iterator insert(const_iterator pos, It first, It last) {
+    const size_t offset = pos - data_;
+    const size_t count = std::distance(first, last);
+    if constexpr (std::is_pointer<It>::value) {
+      if (count && contains(&*first)) {
+        return insert_own(offset, &*first - data_, count);
+      }
+    }
+    reserve(size_ + count);
+    T *at = data_ + offset;
+    std::memmove(at + count, at, (size_ - offset) * sizeof(T));
+    std::copy(first, last, at);
+    size_ += count;
+    return at;
+  }
+
+ private:
+  T *data_;
+  size_t size_;
+  size_t capacity_;
+  size_t mapped_;  // bytes mapped by huge_pages_alloc(), or 0
+  bool huge_;
+  T inline_[N];
+
+  void grow(size_t n) {
+    size_t capacity = std::max(n, 2 * capacity_);
+    size_t mapped = 0;
+    T *data = nullptr;
+    if (huge_ && capacity * sizeof(T) >= kHugePageSize) {
+      data = static_cast<T *>(huge_pages_alloc(capacity * sizeof(T), &mapped));
+      if (data) capacity = mapped / sizeof(T);
+    }
+    if (!data) {
+      data = new T[capacity];
+      mapped = 0;
+    }
+    if (size_) std::memcpy(data, data_, size_ * sizeof(T));
+    release();
+    data_ = data;
+    capacity_ = capacity;
+    mapped_ = mapped;
+  }
+
+  inline bool contains(const T *p) const {
+    const std::less<const T *> less;
+    return !less(p, data_) && less(p, data_ + size_);
+  }
+
+  // insert() of count elements from index from of this vector. Growing can
+  // move them, and so can making room at offset, so they're found again
+  // afterwards by index.
+  iterator insert_own(size_t offset, size_t from, size_t count) {
+    reserve(size_ + count);
+    T *at = data_ + offset;
+    std::memmove(at + count, at, (size_ - offset) * sizeof(T));
+    // the elements before offset stayed put, the rest moved up by count
+    const size_t before = from < offset ? std::min(count, offset - from) : 0;
+    std::memcpy(at, data_ + from, before * sizeof(T));
+    std::memcpy(at + before, data_ + std::max(from, offset) + count,
+                (count - before) * sizeof(T));
+    size_ += count;
+    return at;
+  }
+
+  void release() {
+    if (is_huge()) {
+      huge_pages_free(data_, mapped_);
+    } else if (!is_inline()) {
+      delete[] data_;
+    }
+  }
+};
+}  // namespace cryptopals
@@ -14,24 +14,25 @@
 // You should have received a copy of the GNU General Public License along with
 // cryptopals. If not, see <http://www.gnu.org/licenses/>.
 
+#include <unistd.h>
+
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <random>
 #include <sstream>
 #include <unordered_map>
+#include <vector>
 
+#include "./aes_cipher.h"
 #include "./buffer.h"
+#include "./check.h"
+#include "./corpus.h"
 #include "./solutions.h"
 #include "./util.h"
 
-#define CHECK(cond)                                                           \
-  if (!(cond)) {                                                              \
-    std::cerr << "CHECK failed " __FILE__ ":" << __LINE__ << ": " #cond "\n"; \
-    return false;                                                             \
-  }
-
 namespace cryptopals {
 void add_all_solutions(ProblemManager *manager) {
   manager->AddSolution(1, 1, []() {
@@ -69,11 +70,18 @@ void add_all_solutions(ProblemManager *manager) {
     std::string best_string;
     float best_score = INFINITY;
 
-    std::ifstream infile("data/4.txt");
-    std::string line;
-    while (std::getline(infile, line)) {
-      assert(line.size() <= 60);
-      Buffer buf(line, HEX);
+    // search the lines of data/4.txt decoded into a corpus; the mapping
+    // outlives the file
+    char path[] = "/tmp/cryptopals-corpus-XXXXXX";
+    const int fd = mkstemp(path);
+    CHECK(fd != -1)
+    close(fd);
+    const bool converted = write_corpus("data/4.txt", HEX_LINES, path);
+    const Corpus corpus(path);
+    unlink(path);
+    CHECK(converted && corpus.valid())
+    for (size_t i = 0; i < corpus.size(); i++) {
+      const Buffer buf(corpus[i]);
       std::string s;
       float score;
       buf.guess_single_byte_xor_key(&s, &score);
@@ -198,7 +206,7 @@ void add_all_solutions(ProblemManager *manager) {
 
   manager->AddSolution(2, 12, []() {
     const Buffer suffix("data/12.txt", BASE64_FILE);
-    const std::string key = rand_key();
+    const AesKey key(rand_key());
     auto oracle = [&suffix, &key](Buffer &buf) {
       buf.append(suffix);
       buf.aes_ecb_encrypt(key);
@@ -268,5 +276,40 @@ void add_all_solutions(ProblemManager *manager) {
     std::string s((const char *)bytes.data(), bytes.size());
     return s.find("Did you stop?") != std::string::npos;
   });
+
+  manager->AddSolution(3, 18, []() {
+    Buffer buf(
+        "L77na/nrFsKvynd6HzOoG7GHTLXsTVu9qvY/2syLXzhPweyyMTJULu/6/kXX0KSvoOLSF"
+        "Q==",
+        BASE64);
+    auto copy = buf;
+    buf.aes_ctr_xcrypt("YELLOW SUBMARINE", 0);
+    CHECK(buf.encode() ==
+          "Yo, VIP Let's kick it Ice, Ice, baby Ice, Ice, baby ")
+    buf.aes_ctr_xcrypt("YELLOW SUBMARINE", 0);
+    return buf == copy;
+  });
+
+  manager->AddSolution(4, 25, []() {
+    Buffer plaintext("data/25.txt", BASE64_FILE);
+    plaintext.aes_ecb_decrypt("YELLOW SUBMARINE");
+
+    const std::string key = rand_key();
+    const uint64_t nonce = std::random_device()();
+    Buffer ciphertext = plaintext;
+    ciphertext.aes_ctr_xcrypt(key, nonce);
+
+    // the edit function exposed to the attacker
+    auto edit = [&key, nonce](Buffer &buf, size_t offset,
+                              const Buffer &newtext) {
+      buf.aes_ctr_edit(key, nonce, offset, newtext);
+    };
+
+    // editing a range to its own ciphertext writes keystream ^ ciphertext,
+    // which is the plaintext
+    Buffer recovered = ciphertext;
+    edit(recovered, 0, ciphertext);
+    return recovered == plaintext;
+  });
 }
 }  // namespace cryptopals
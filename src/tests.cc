@@ -0,0 +1,784 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+// Unit tests for the kernels and data structures the solutions are built on,
+// run by "make check". The solutions themselves only check their challenge.
+// Inputs are generated rather than read from data/, so this runs from any
+// directory.
+
+#include <unistd.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./aes.hpp"
+#include "./aes_cipher.h"
+#include "./aes_stream.h"
+#include "./base64.h"
+#include "./buffer.h"
+#include "./check.h"
+#include "./corpus.h"
+#include "./cpu.h"
+#include "./dictionary.h"
+#include "./ghash.h"
+#include "./hex.h"
+#include "./histogram.h"
+#include "./huge_pages.h"
+#include "./thread_pool.h"
+#include "./util.h"
+#include "./words.h"
+#include "./xor.h"
+
+namespace cryptopals {
+
+// the ciphertext from challenge 1.3, for tests that want English text
+static const char kSampleHex[] =
+    "1b37373331363f78151b7f2b783431333d78397828372d363c78373e783a393b3736";
+
+// Write contents to a new temporary file, and return its path.
+static std::string temp_file(const std::string &contents) {
+  char path[] = "/tmp/cryptopals-test-XXXXXX";
+  const int fd = mkstemp(path);
+  assert(fd != -1);
+  close(fd);
+  std::ofstream(path) << contents;
+  return path;
+}
+
+// text as it appears in the challenge files: wrapped at 60 columns, with a
+// line break at the end
+static std::string wrap_lines(const std::string &text) {
+  std::string out;
+  for (size_t i = 0; i < text.size(); i += 60) {
+    out += text.substr(i, 60) + "\n";
+  }
+  return out;
+}
+
+static bool test_hex() {
+  // uppercase digits decode the same way
+  CHECK(Buffer("49276D206B696C6C", HEX) == Buffer("49276d206b696c6c", HEX))
+
+  // every hex implementation the cpu supports agrees with the scalar one,
+  // including the tails that don't fill a whole vector
+  const HEX_impl original = HEX_get_impl();
+  for (int impl = HEX_IMPL_SCALAR; impl <= HEX_IMPL_AVX2; impl++) {
+    if (!HEX_set_impl(static_cast<HEX_impl>(impl))) {
+      continue;
+    }
+    for (size_t len = 0; len <= 130; len++) {
+      const std::string bytes = rand_string(len);
+      const uint8_t *data = reinterpret_cast<const uint8_t *>(bytes.data());
+      std::string hex(2 * len, '\0'), expected(2 * len, '\0');
+      HEX_encode(data, len, &hex[0]);
+      HEX_set_impl(HEX_IMPL_SCALAR);
+      HEX_encode(data, len, &expected[0]);
+      HEX_set_impl(static_cast<HEX_impl>(impl));
+      CHECK(hex == expected)
+
+      std::string decoded(len, '\0');
+      CHECK(HEX_decode(hex.data(), hex.size(),
+                       reinterpret_cast<uint8_t *>(&decoded[0])))
+      CHECK(decoded == bytes)
+      if (len) {
+        // a non-digit anywhere is rejected
+        hex[(len * 7) % hex.size()] = "g/:@`G"[len % 6];
+        CHECK(!HEX_decode(hex.data(), hex.size(),
+                          reinterpret_cast<uint8_t *>(&decoded[0])))
+      }
+    }
+  }
+  HEX_set_impl(original);
+  return true;
+}
+
+static bool test_base64() {
+  // every base64 implementation the cpu supports agrees with the scalar one,
+  // for the tails and their padding too
+  const BASE64_impl original = BASE64_get_impl();
+  for (int impl = BASE64_IMPL_SCALAR; impl <= BASE64_IMPL_AVX2; impl++) {
+    if (!BASE64_set_impl(static_cast<BASE64_impl>(impl))) {
+      continue;
+    }
+    for (size_t len = 0; len <= 130; len++) {
+      const std::string bytes = rand_string(len);
+      const uint8_t *data = reinterpret_cast<const uint8_t *>(bytes.data());
+      std::string b64(BASE64_ENCODED_LEN(len), '\0');
+      std::string expected(BASE64_ENCODED_LEN(len), '\0');
+      BASE64_encode(data, len, &b64[0]);
+      BASE64_set_impl(BASE64_IMPL_SCALAR);
+      BASE64_encode(data, len, &expected[0]);
+      BASE64_set_impl(static_cast<BASE64_impl>(impl));
+      CHECK(b64 == expected)
+
+      std::string decoded(BASE64_DECODED_MAX(b64.size()), '\0');
+      size_t size;
+      CHECK(BASE64_decode(b64.data(), b64.size(),
+                          reinterpret_cast<uint8_t *>(&decoded[0]), &size))
+      decoded.resize(size);
+      CHECK(decoded == bytes)
+      if (len) {
+        // a character outside the alphabet anywhere is rejected
+        b64[(len * 7) % b64.size()] = "-_.:@[`{ "[len % 9];
+        decoded.resize(BASE64_DECODED_MAX(b64.size()));
+        CHECK(!BASE64_decode(b64.data(), b64.size(),
+                             reinterpret_cast<uint8_t *>(&decoded[0]), &size))
+      }
+    }
+
+    // and so is padding anywhere but the last two characters
+    for (size_t pos = 0; pos < 126; pos++) {
+      std::string b64(128, 'A');
+      b64[pos] = '=';
+      uint8_t decoded[BASE64_DECODED_MAX(128)];
+      size_t size;
+      CHECK(!BASE64_decode(b64.data(), b64.size(), decoded, &size))
+    }
+  }
+  BASE64_set_impl(original);
+
+  // the incremental decoder gives the same bytes however the file is split
+  // up, with unix or dos line breaks
+  const Buffer bytes(rand_string(3000));
+  const std::string unix_text = wrap_lines(bytes.encode_base64());
+  std::string dos_text;
+  for (char c : unix_text) {
+    if (c == '\n') dos_text += '\r';
+    dos_text += c;
+  }
+  for (const std::string &text : {unix_text, dos_text}) {
+    for (size_t chunk : {1, 3, 61, 4096, 5000, 1 << 20}) {
+      BASE64_decoder decoder;
+      BASE64_decoder_init(&decoder);
+      std::vector<uint8_t> out;
+      for (size_t i = 0; i < text.size(); i += chunk) {
+        const size_t n = std::min(chunk, text.size() - i);
+        const size_t start = out.size();
+        out.resize(start + BASE64_DECODED_MAX(n + 3));
+        size_t size;
+        CHECK(BASE64_decoder_update(&decoder, text.data() + i, n,
+                                    out.data() + start, &size))
+        out.resize(start + size);
+      }
+      CHECK(BASE64_decoder_finish(&decoder))
+      CHECK(Buffer(out) == bytes)
+    }
+  }
+
+  // while data after padding, or a partial group at the end, is an error
+  BASE64_decoder decoder;
+  uint8_t scratch[16];
+  size_t size;
+  BASE64_decoder_init(&decoder);
+  CHECK(!BASE64_decoder_update(&decoder, "QQ==\nQQ==", 9, scratch, &size))
+  BASE64_decoder_init(&decoder);
+  CHECK(BASE64_decoder_update(&decoder, "QUJD\nQUJ", 8, scratch, &size))
+  CHECK(size == 3 && !BASE64_decoder_finish(&decoder))
+  return true;
+}
+
+static bool test_xor() {
+  // every xor implementation the cpu supports matches a plain loop, for keys
+  // shorter and longer than a vector and for the tails
+  const XOR_impl original = XOR_get_impl();
+  for (int impl = XOR_IMPL_SCALAR; impl <= XOR_IMPL_AVX512; impl++) {
+    if (!XOR_set_impl(static_cast<XOR_impl>(impl))) {
+      continue;
+    }
+    for (size_t key_len : {1, 3, 16, 32, 37, 64, 100, 2000}) {
+      const std::string key = rand_string(key_len);
+      for (size_t len : {0, 1, 31, 32, 63, 64, 65, 200, 1000, 5000}) {
+        const Buffer data(rand_string(len));
+        std::string expected = data.encode();
+        for (size_t i = 0; i < len; i++) expected[i] ^= key[i % key_len];
+        Buffer out;
+        data.xor_string_into(key, &out);
+        CHECK(out.encode() == expected)
+
+        Buffer in_place = data;
+        in_place.xor_string(key);
+        CHECK(in_place == out)
+        in_place ^= data;
+        for (size_t i = 0; i < len; i++) {
+          CHECK(in_place[i] == static_cast<uint8_t>(key[i % key_len]))
+        }
+      }
+    }
+  }
+  XOR_set_impl(original);
+  return true;
+}
+
+static bool test_into() {
+  // the out of place operations match the in place ones, and a moved buffer
+  // keeps its contents
+  const Buffer buf(kSampleHex, HEX);
+  Buffer expected = buf, scratch;
+  expected.xor_byte(0x58);
+  buf.xor_byte_into(0x58, &scratch);
+  CHECK(scratch == expected)
+  std::string hex;
+  scratch.encode_hex_into(&hex);
+  CHECK(hex == expected.encode_hex())
+  Buffer moved = std::move(scratch);
+  CHECK(moved == expected)
+
+  expected = buf;
+  expected.xor_string("ICE");
+  buf.xor_string_into("ICE", &scratch);
+  CHECK(scratch == expected)
+
+  expected = buf;
+  expected.aes_ecb_encrypt("YELLOW SUBMARINE");
+  buf.aes_ecb_encrypt_into("YELLOW SUBMARINE", &scratch);
+  CHECK(scratch == expected)
+  CHECK(buf == Buffer(kSampleHex, HEX))
+  return true;
+}
+
+static bool test_histogram() {
+  // the histogram ranking keeps the key that scoring every key finds
+  const Buffer buf(kSampleHex, HEX);
+  const uint8_t key = buf.guess_single_byte_xor_key();
+  uint8_t exhaustive_key = 0;
+  float exhaustive_score = std::numeric_limits<float>::max();
+  Buffer scratch;
+  for (int k = 0; k <= 255; k++) {
+    buf.xor_byte_into(static_cast<uint8_t>(k), &scratch);
+    const float score = scratch.string_score();
+    if (score < exhaustive_score) {
+      exhaustive_score = score;
+      exhaustive_key = static_cast<uint8_t>(k);
+    }
+  }
+  CHECK(key == exhaustive_key)
+
+  // the histogram kernels agree, on uneven lengths and on long runs
+  const HIST_impl original = HIST_get_impl();
+  const std::string bytes = rand_string(1000) + std::string(300, 'e');
+  for (size_t len : {0, 7, 8, 999, 1300}) {
+    size_t counts[2][256];
+    for (auto impl : {HIST_IMPL_SCALAR, HIST_IMPL_UNROLLED}) {
+      HIST_set_impl(impl);
+      HIST_count(reinterpret_cast<const uint8_t *>(bytes.data()), len,
+                 counts[impl]);
+    }
+    CHECK(std::memcmp(counts[0], counts[1], sizeof(counts[0])) == 0)
+    size_t total = 0;
+    for (size_t count : counts[0]) total += count;
+    CHECK(total == len)
+  }
+  HIST_set_impl(original);
+  return true;
+}
+
+static bool test_dictionary() {
+  // a word list compiles to an index of its words in lowercase, the same
+  // whether it's written out or built in memory; lines that aren't all
+  // letters can't match a word of text and are left out
+  const std::string path = temp_file(
+      "Cooking\nbacon\nbacon\nlike\ndon't\npound\nMC's\nExtraordinarily\n");
+  const std::string index_path = path + ".idx";
+  CHECK(write_dictionary(path, index_path))
+  const Dictionary index(index_path);
+  const std::unique_ptr<const Dictionary> built = Dictionary::build(path);
+  for (const Dictionary *dict : {&index, built.get()}) {
+    CHECK(dict->valid() && dict->size() == 5)
+    for (const char *word :
+         {"cooking", "bacon", "like", "pound", "extraordinarily"}) {
+      CHECK(dict->contains(word))
+    }
+    for (const char *word : {"Cooking", "dont", "mcs", "extra", "bacons"}) {
+      CHECK(!dict->contains(word))
+    }
+  }
+
+  // a word hashed a letter at a time is found from text in any case, with
+  // other characters skipped
+  uint64_t hash = index.hash_start();
+  for (char c : std::string("cooking")) hash = Dictionary::hash_step(hash, c);
+  CHECK(index.contains(hash, "CoOk'ing"))
+  CHECK(!index.contains(hash, "cookin") && !index.contains(hash, "cookinG!s"))
+
+  // one scorer can be shared by threads, and the first of them to need the
+  // dictionary loads it for all of them; the pool has its own threads so
+  // that several score at once even on one core
+  const TextScorer scorer(index_path, path);
+  ThreadPool pool(4);
+  const Buffer buf(kSampleHex, HEX);
+  Buffer scratch;
+  std::vector<std::string> candidates;
+  for (int k = 0; k <= 255; k++) {
+    buf.xor_byte_into(static_cast<uint8_t>(k), &scratch);
+    candidates.emplace_back(scratch.view().str());
+  }
+  std::vector<float> scores(candidates.size());
+  pool.parallel_for(candidates.size(), 16, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      scores[i] = scorer.score(candidates[i]);
+    }
+  });
+  // scores are floats, so allow for rounding rather than expecting every
+  // build to add them up identically
+  auto near = [](float a, float b) {
+    return a == b || std::fabs(a - b) <= 1e-5f * std::fabs(b);
+  };
+  for (size_t i = 0; i < candidates.size(); i++) {
+    CHECK(near(scores[i], scorer.score(candidates[i])))
+  }
+  const std::string text = "Cooking MC's like a pound of bacon";
+  CHECK(scorer.score(text) < scorer.score(text, false))
+
+  CHECK(truncate(index_path.c_str(), 100) == 0)
+  CHECK(!Dictionary(index_path).valid())
+  unlink(index_path.c_str());
+  unlink(path.c_str());
+  CHECK(!Dictionary(index_path).valid())
+  CHECK(Dictionary::build(path)->size() == 0)
+  return true;
+}
+
+static bool test_cpu_tiers() {
+  // every cpu tier gets the same distances, and capping the tier rebinds all
+  // the kernels; AES keys expanded before then keep their backend, but the
+  // cached ones are expanded again
+  const CPU_tier original = CPU_get_tier();
+  const AesKey held("YELLOW SUBMARINE");
+  const AES_backend held_backend = held.backend();
+  const Buffer x(rand_string(1000)), y(rand_string(1000));
+  std::vector<size_t> distances;
+  for (size_t len : {0, 7, 31, 32, 33, 999, 1000}) {
+    distances.push_back(x.slice(0, len).edit_distance(y.slice(0, len)));
+  }
+  for (int tier = CPU_TIER_SCALAR; tier <= CPU_TIER_AVX512; tier++) {
+    CPU_set_tier(static_cast<CPU_tier>(tier));
+    size_t i = 0;
+    for (size_t len : {0, 7, 31, 32, 33, 999, 1000}) {
+      CHECK(x.slice(0, len).edit_distance(y.slice(0, len)) == distances[i++])
+    }
+    if (tier == CPU_TIER_SCALAR) {
+      CHECK(CPU_features() == 0)
+      CHECK(AES_get_backend() == AES_BACKEND_TTABLE)
+      CHECK(held.backend() == held_backend)
+      CHECK(AesKey::cached("YELLOW SUBMARINE")->backend() ==
+            AES_BACKEND_TTABLE)
+      CHECK(HEX_get_impl() == HEX_IMPL_SCALAR)
+      CHECK(BASE64_get_impl() == BASE64_IMPL_SCALAR)
+      CHECK(XOR_get_impl() == XOR_IMPL_SCALAR)
+      CHECK(!XOR_set_impl(XOR_IMPL_AVX2))
+      CHECK(HIST_get_impl() == HIST_IMPL_SCALAR)
+    }
+  }
+  CPU_set_tier(original);
+  return true;
+}
+
+static bool test_aes() {
+  // every AES backend should agree with the FIPS-197 example vectors, with
+  // the byte-wise tiny-AES reference, with each other for the key sizes
+  // tiny-AES isn't built for, and with the backend that encrypted a message
+  const AES_backend original = AES_get_backend();
+  const Buffer message(rand_string(AES_BLOCKLEN * 37));
+  Buffer encrypted = message;
+  encrypted.aes_ecb_encrypt("YELLOW SUBMARINE", false);
+  const std::string fips_key =
+      Buffer("000102030405060708090a0b0c0d0e0f", HEX).encode();
+  std::vector<std::pair<std::string, Buffer>> wide;
+  std::vector<Buffer> wide_expected;
+  for (int i = 0; i < 16; i++) {
+    wide.emplace_back(rand_string(i % 2 ? 24 : 32),
+                      Buffer(rand_string(AES_BLOCKLEN)));
+  }
+  for (auto backend : {AES_BACKEND_TTABLE, AES_BACKEND_AESNI}) {
+    if (!AES_set_backend(backend)) continue;
+    for (int i = 0; i < 16; i++) {
+      const std::string key = rand_key();
+      Buffer block(rand_string(AES_BLOCKLEN));
+      AES_ctx ctx;
+      AES_init_ctx(&ctx, reinterpret_cast<const uint8_t *>(key.data()));
+      uint8_t expected[AES_BLOCKLEN], batch[AES_BLOCKLEN * AES_ECB_BATCH];
+      std::memcpy(expected, block.view().data(), AES_BLOCKLEN);
+      for (int j = 0; j < AES_ECB_BATCH; j++) {
+        std::memcpy(batch + j * AES_BLOCKLEN, expected, AES_BLOCKLEN);
+      }
+      AES_ECB_encrypt_reference(&ctx, expected);
+      AES_ECB_encrypt_x8(&ctx, batch);
+      for (int j = 0; j < AES_ECB_BATCH; j++) {
+        CHECK(std::memcmp(batch + j * AES_BLOCKLEN, expected, AES_BLOCKLEN) ==
+              0)
+      }
+      AES_ECB_decrypt(&ctx, batch);
+      AES_ECB_encrypt(&ctx, batch);
+      CHECK(std::memcmp(batch, expected, AES_BLOCKLEN) == 0)
+      block.aes_ecb_encrypt(key, false);
+      CHECK(std::memcmp(block.view().data(), expected, AES_BLOCKLEN) == 0)
+      AES_ECB_decrypt_reference(&ctx, expected);
+      block.aes_ecb_decrypt(key, false);
+      CHECK(std::memcmp(block.view().data(), expected, AES_BLOCKLEN) == 0)
+    }
+    for (size_t i = 0; i < wide.size(); i++) {
+      Buffer block = wide[i].second;
+      block.aes_ecb_encrypt(wide[i].first, false);
+      if (wide_expected.size() == i) wide_expected.push_back(block);
+      CHECK(block == wide_expected[i])
+      block.aes_ecb_decrypt(wide[i].first, false);
+      CHECK(block == wide[i].second)
+    }
+
+    Buffer block("00112233445566778899aabbccddeeff", HEX);
+    block.aes_ecb_encrypt(fips_key, false);
+    CHECK(block.encode_hex() == "69c4e0d86a7b0430d8cdb78070b4c55a")
+    block.aes_ecb_decrypt(fips_key, false);
+    CHECK(block.encode_hex() == "00112233445566778899aabbccddeeff")
+
+    // FIPS-197 appendix C vectors for the larger key sizes
+    const std::string fips_key192 =
+        Buffer("000102030405060708090a0b0c0d0e0f1011121314151617", HEX)
+            .encode();
+    block.aes_ecb_encrypt(fips_key192, false);
+    CHECK(block.encode_hex() == "dda97ca4864cdfe06eaf70a0ec0d7191")
+    block.aes_ecb_decrypt(fips_key192, false);
+    CHECK(block.encode_hex() == "00112233445566778899aabbccddeeff")
+
+    const std::string fips_key256 =
+        Buffer(
+            "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f",
+            HEX)
+            .encode();
+    block.aes_ecb_encrypt(fips_key256, false);
+    CHECK(block.encode_hex() == "8ea2b7ca516745bfeafc49904b496089")
+    block.aes_ecb_decrypt(fips_key256, false);
+    CHECK(block.encode_hex() == "00112233445566778899aabbccddeeff")
+
+    // and a full batch, which goes through the multi-block path
+    Buffer batch;
+    for (int i = 0; i < AES_ECB_BATCH; i++) batch.append(block);
+    batch.aes_ecb_encrypt(fips_key256, false);
+    for (size_t i = 0; i < batch.size(); i += AES_BLOCKLEN) {
+      CHECK(batch.slice(i, i + AES_BLOCKLEN).encode_hex() ==
+            "8ea2b7ca516745bfeafc49904b496089")
+    }
+
+    Buffer other = encrypted;
+    other.aes_ecb_decrypt("YELLOW SUBMARINE", false);
+    CHECK(other == message)
+    other.aes_ecb_encrypt("YELLOW SUBMARINE", false);
+    CHECK(other == encrypted)
+  }
+  AES_set_backend(original);
+  return true;
+}
+
+static bool test_huge_pages() {
+  // huge page storage (which has to regrow here) works like the heap
+  const Buffer chunk(rand_string(AES_BLOCKLEN * 4096));
+  Buffer huge, heap;
+  huge.reserve(kHugePageSize, HUGE_PAGE_STORAGE);
+  while (huge.size() <= kHugePageSize) {
+    huge.append(chunk);
+    heap.append(chunk);
+  }
+  huge.aes_ecb_decrypt("YELLOW SUBMARINE", false);
+  heap.aes_ecb_decrypt("YELLOW SUBMARINE", false);
+  CHECK(huge == heap)
+  Buffer moved = std::move(huge);
+  CHECK(moved == heap)
+  return true;
+}
+
+static bool test_corpus() {
+  // a corpus converted from text holds the same records, and one that isn't
+  // there opens as invalid
+  std::vector<Buffer> records;
+  std::string hex_lines, base64_lines;
+  for (int i = 0; i < 50; i++) {
+    records.emplace_back(rand_string(1, 60));
+    hex_lines += records.back().encode_hex() + "\n";
+    base64_lines += records.back().encode_base64() + "\n";
+  }
+  const Buffer blob(rand_string(3000));
+  const std::pair<std::string, TextFormat> inputs[] = {
+      {temp_file(hex_lines), HEX_LINES},
+      {temp_file(base64_lines), BASE64_LINES},
+      {temp_file(wrap_lines(blob.encode_base64())), BASE64_TEXT}};
+  const std::string path = temp_file("");
+  for (const auto &[text_path, format] : inputs) {
+    CHECK(write_corpus(text_path, format, path))
+    unlink(text_path.c_str());
+    const Corpus corpus(path);
+    CHECK(corpus.valid())
+    if (format == BASE64_TEXT) {
+      CHECK(corpus.size() == 1 && corpus[0] == blob)
+      continue;
+    }
+    CHECK(corpus.size() == records.size())
+    for (size_t i = 0; i < records.size(); i++) {
+      CHECK(corpus[i] == records[i])
+    }
+  }
+
+  // text that isn't hex or base64 isn't converted
+  const std::string bad_hex = temp_file("0123abcd\n0123abcx\n");
+  CHECK(!write_corpus(bad_hex, HEX_LINES, path))
+  unlink(bad_hex.c_str());
+  const std::string bad_base64 = temp_file("SGVsbG8=\nSGV*bG8=\n");
+  CHECK(!write_corpus(bad_base64, BASE64_LINES, path))
+  CHECK(!write_corpus(bad_base64, BASE64_TEXT, path))
+  unlink(bad_base64.c_str());
+  CHECK(Corpus(path).valid())
+
+  CHECK(truncate(path.c_str(), 30) == 0)
+  CHECK(!Corpus(path).valid())
+  unlink(path.c_str());
+  CHECK(!Corpus(path).valid())
+  return true;
+}
+
+static bool test_inline_storage() {
+  // padding across the inline storage limit moves the data to the heap
+  Buffer big(std::string(Buffer::kInlineSize - 4, 'A'));
+  Buffer copy = big;
+  big.pad_pkcs7(Buffer::kInlineSize);
+  CHECK(big.size() == Buffer::kInlineSize)
+  big.pad_pkcs7(Buffer::kInlineSize);
+  CHECK(big.size() == 2 * Buffer::kInlineSize)
+  big.unpad_pkcs7();
+  big.unpad_pkcs7();
+  CHECK(big == copy)
+
+  // a buffer can append a slice of itself, even when that reallocates
+  for (size_t size : {size_t(10), Buffer::kInlineSize, size_t(100)}) {
+    const std::string text = rand_string(size);
+    Buffer self(text);
+    self.append(self.slice(size / 2, size));
+    self.append(self.view());
+    const std::string once = text + text.substr(size / 2);
+    CHECK(self.encode() == once + once)
+  }
+  return true;
+}
+
+static bool test_cbc() {
+  // big buffers are split across threads, which must not change the result
+  Buffer big(rand_string(AES_BLOCKLEN * 12000));
+  Buffer serial = big;
+  serial.aes_cbc_decrypt("YELLOW SUBMARINE", false);
+  const size_t threshold = Buffer::parallel_threshold();
+  Buffer::set_parallel_threshold(0);
+  big.aes_cbc_decrypt("YELLOW SUBMARINE", false);
+  Buffer::set_parallel_threshold(threshold);
+  CHECK(big == serial)
+
+  // batched encryption of unrelated messages matches one at a time
+  std::vector<Buffer> plain, batch;
+  for (size_t i = 0; i < 20; i++) {
+    plain.emplace_back(rand_string(1, 200));
+    batch.push_back(plain.back());
+  }
+  std::vector<CbcJob> jobs;
+  for (size_t i = 0; i < batch.size(); i++) {
+    jobs.push_back({rand_string(16 + 8 * (i % 3)),
+                    i % 2 ? rand_string(AES_BLOCKLEN) : "", &batch[i]});
+  }
+  Buffer::aes_cbc_encrypt_batch(jobs);
+  for (size_t i = 0; i < jobs.size(); i++) {
+    Buffer expected = plain[i];
+    if (jobs[i].iv.empty()) {
+      expected.aes_cbc_encrypt(jobs[i].key);
+      CHECK(batch[i] == expected)
+      continue;
+    }
+    // aes_cbc_decrypt() assumes a zero iv, which only affects the first block
+    expected.pad_pkcs7(AES_BLOCKLEN);
+    Buffer decrypted = batch[i];
+    decrypted.aes_cbc_decrypt(jobs[i].key, false);
+    Buffer first(decrypted.slice(0, AES_BLOCKLEN));
+    first ^= Buffer(jobs[i].iv);
+    first.append(decrypted.slice(AES_BLOCKLEN, decrypted.size()));
+    CHECK(first == expected)
+  }
+  return true;
+}
+
+static bool test_ctr() {
+  const Buffer plaintext(rand_string(300));
+  Buffer ciphertext = plaintext;
+  ciphertext.aes_ctr_xcrypt("YELLOW SUBMARINE", 0);
+
+  // the keystream can be entered at any offset
+  for (size_t i = 0; i < ciphertext.size(); i++) {
+    Buffer tail(ciphertext.slice(i, ciphertext.size()));
+    tail.aes_ctr_xcrypt("YELLOW SUBMARINE", 0, i);
+    CHECK(tail == plaintext.slice(i, plaintext.size()))
+  }
+
+  // and an edit only changes the bytes it covers
+  Buffer edited = ciphertext;
+  edited.aes_ctr_edit("YELLOW SUBMARINE", 0, 100, Buffer("hello"));
+  edited.aes_ctr_xcrypt("YELLOW SUBMARINE", 0);
+  CHECK(edited.slice(100, 105).encode() == "hello")
+  CHECK(edited.slice(0, 100) == plaintext.slice(0, 100))
+  CHECK(edited.slice(105, edited.size()) ==
+        plaintext.slice(105, plaintext.size()))
+  return true;
+}
+
+static bool test_aes_stream() {
+  // streaming a chunk at a time gives the same output as all at once
+  const Buffer plain(rand_string(3000));
+  Buffer cbc = plain;
+  cbc.aes_cbc_encrypt("YELLOW SUBMARINE");
+  for (size_t chunk_size : {1, 16, 37, 4096}) {
+    std::stringstream ciphertext(cbc.encode()), plaintext;
+    AesStream decrypt("YELLOW SUBMARINE", AesStream::CBC_DECRYPT);
+    CHECK(decrypt.process(ciphertext, plaintext, chunk_size))
+    CHECK(plaintext.str() == plain.encode())
+
+    std::stringstream reencrypted;
+    AesStream encrypt("YELLOW SUBMARINE", AesStream::CBC_ENCRYPT);
+    CHECK(encrypt.process(plaintext, reencrypted, chunk_size))
+    CHECK(reencrypted.str() == cbc.encode())
+  }
+
+  Buffer ctr = plain;
+  ctr.aes_ctr_xcrypt("YELLOW SUBMARINE", 0);
+  std::stringstream ciphertext(ctr.encode()), plaintext;
+  AesStream stream("YELLOW SUBMARINE", AesStream::CTR_XCRYPT);
+  CHECK(stream.process(ciphertext, plaintext, 5))
+  CHECK(plaintext.str() == plain.encode())
+
+  // truncated ciphertext and bad padding are errors, not garbage output
+  const std::string good = cbc.encode();
+  std::stringstream truncated(good.substr(0, good.size() - 5)), out;
+  AesStream decrypt("YELLOW SUBMARINE", AesStream::CBC_DECRYPT);
+  CHECK(!decrypt.process(truncated, out, 16))
+
+  Buffer bad_pad("YELLOW SUBMARINE");
+  bad_pad.aes_cbc_encrypt("YELLOW SUBMARINE", false);
+  std::stringstream bad(bad_pad.encode()), bad_out;
+  AesStream bad_decrypt("YELLOW SUBMARINE", AesStream::CBC_DECRYPT);
+  CHECK(!bad_decrypt.process(bad, bad_out, 16))
+  CHECK(bad_out.str().empty())
+  return true;
+}
+
+static bool test_gcm() {
+  // GCM is a CTR mode plus the GHASH authenticator; check it against the
+  // test vectors from the GCM spec.
+  struct GcmVector {
+    const char *key, *iv, *plaintext, *aad, *ciphertext, *tag;
+  };
+  const std::string p60 =
+      "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+      "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39";
+  const std::string c60 =
+      "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+      "21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091";
+  const std::string p64 = p60 + "1aafd255";
+  const std::string c64 = c60 + "473f5985";
+  const std::string zero128(32, '0'), zero256(64, '0');
+  const GcmVector gcm_vectors[] = {
+      {zero128.c_str(), "000000000000000000000000", "", "", "",
+       "58e2fccefa7e3061367f1d57a4e7455a"},
+      {zero128.c_str(), "000000000000000000000000", zero128.c_str(), "",
+       "0388dace60b6a392f328c2b971b2fe78", "ab6e47d42cec13bdf53a67b21257bddf"},
+      {"feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888",
+       p64.c_str(), "", c64.c_str(), "4d5c2af327cd64a62cf35abd2ba6fab4"},
+      {"feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888",
+       p60.c_str(), "feedfacedeadbeeffeedfacedeadbeefabaddad2", c60.c_str(),
+       "5bc94fbc3221a5db94fae95ae7121a47"},
+      {"feffe9928665731c6d6a8f9467308308", "cafebabefacedbad", p60.c_str(),
+       "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+       "61353b4c2806934a777ff51fa22a4755699b2a714fcdc6f83766e5f97b6c7423"
+       "73806900e49f24b22b097544d4896b424989b5e1ebac0f07c23f4598",
+       "3612d2e79e3b0785561be14aaca2fccb"},
+      {zero256.c_str(), "000000000000000000000000", "", "", "",
+       "530f8afbc74536b9a963b4f1c4cb738b"},
+      {zero256.c_str(), "000000000000000000000000", zero128.c_str(), "",
+       "cea7403d4d606b6e074ec5d3baf39d18", "d0d1c8a799996bf0265b98b5d48ab919"},
+  };
+  for (const auto &v : gcm_vectors) {
+    const std::string key = Buffer(v.key, HEX).encode();
+    const Buffer iv(v.iv, HEX), aad(v.aad, HEX), tag(v.tag, HEX);
+    Buffer data(v.plaintext, HEX);
+    CHECK(data.aes_gcm_encrypt(key, iv, aad) == tag)
+    CHECK(data.encode_hex() == v.ciphertext)
+    CHECK(!data.aes_gcm_decrypt(key, iv, tag, Buffer("tampered")))
+    CHECK(data.encode_hex() == v.ciphertext)
+    CHECK(data.aes_gcm_decrypt(key, iv, tag, aad))
+    CHECK(data.encode_hex() == v.plaintext)
+  }
+
+  // the 4-bit table fallback must agree with the PCLMULQDQ code
+  if (GHASH_clmul_supported()) {
+    const std::string h = rand_key();
+    std::string blocks;
+    for (int i = 0; i < 7; i++) {
+      blocks += rand_key();
+    }
+    const auto *h_bytes = reinterpret_cast<const uint8_t *>(h.data());
+    const auto *data = reinterpret_cast<const uint8_t *>(blocks.data());
+    GHASH_ctx fast, slow;
+    GHASH_init(&fast, h_bytes, 1);
+    GHASH_init(&slow, h_bytes, 0);
+    uint8_t y_fast[GHASH_BLOCKLEN] = {0}, y_slow[GHASH_BLOCKLEN] = {0};
+    GHASH_update(&fast, y_fast, data, blocks.size());
+    GHASH_update(&slow, y_slow, data, blocks.size());
+    CHECK(std::memcmp(y_fast, y_slow, GHASH_BLOCKLEN) == 0)
+  }
+  return true;
+}
+
+// Run every test, and return the number of failures.
+static int run_tests() {
+  static const std::pair<const char *, bool (*)()> tests[] = {
+      {"hex", test_hex},
+      {"base64", test_base64},
+      {"xor", test_xor},
+      {"into", test_into},
+      {"histogram", test_histogram},
+      {"dictionary", test_dictionary},
+      {"cpu tiers", test_cpu_tiers},
+      {"aes", test_aes},
+      {"huge pages", test_huge_pages},
+      {"corpus", test_corpus},
+      {"inline storage", test_inline_storage},
+      {"cbc", test_cbc},
+      {"ctr", test_ctr},
+      {"aes stream", test_aes_stream},
+      {"gcm", test_gcm},
+  };
+  int fails = 0;
+  for (const auto &[name, test] : tests) {
+    std::cout << name << " " << std::flush;
+    const bool ok = test();
+    std::cout << (ok ? "OK" : "FAIL") << std::endl;
+    fails += !ok;
+  }
+  return fails;
+}
+}  // namespace cryptopals
+
+int main() { return cryptopals::run_tests() == 0 ? 0 : 1; }
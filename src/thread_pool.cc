@@ -0,0 +1,121 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+#include "./thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace cryptopals {
+
+ThreadPool::ThreadPool(size_t threads) : stop_(false) {
+  // the caller of parallel_for() is one of the threads doing the work
+  for (size_t i = 1; i < threads; i++) {
+    workers_.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &t : workers_) {
+    t.join();
+  }
+}
+
+ThreadPool &ThreadPool::global() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::submit(std::function<void(void)> task) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    tasks_.push(std::move(task));
+  }
+  cv_.notify_one();
+}
+
+void ThreadPool::work() {
+  for (;;) {
+    std::function<void(void)> task;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+      if (stop_ && tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+namespace {
+// Shared between the caller of parallel_for() and its helpers. Helpers that
+// only start after every chunk has been claimed never call f, but they can
+// outlive the call, so this is reference counted.
+struct ParallelFor {
+  ParallelFor(size_t n, size_t chunk_size,
+              const std::function<void(size_t, size_t)> &f)
+      : n(n), chunk_size(chunk_size), chunks((n + chunk_size - 1) / chunk_size),
+        f(f), next(0), done(0) {}
+
+  const size_t n, chunk_size, chunks;
+  const std::function<void(size_t, size_t)> f;
+  std::atomic<size_t> next;
+  size_t done;
+  std::mutex mu;
+  std::condition_variable cv;
+
+  void run() {
+    size_t finished = 0;
+    for (size_t c; (c = next++) < chunks; finished++) {
+      f(c * chunk_size, std::min(n, (c + 1) * chunk_size));
+    }
+    if (finished) {
+      std::lock_guard<std::mutex> lock(mu);
+      done += finished;
+      if (done == chunks) cv.notify_all();
+    }
+  }
+};
+}  // namespace
+
+void ThreadPool::parallel_for(size_t n, size_t chunk_size,
+                              const std::function<void(size_t, size_t)> &f) {
+  if (n == 0) return;
+  if (chunk_size == 0 || chunk_size >= n || workers_.empty()) {
+    f(0, n);
+    return;
+  }
+
+  auto state = std::make_shared<ParallelFor>(n, chunk_size, f);
+  const size_t helpers = std::min(workers_.size(), state->chunks - 1);
+  for (size_t i = 0; i < helpers; i++) {
+    submit([state]() { state->run(); });
+  }
+  state->run();
+
+  std::unique_lock<std::mutex> lock(state->mu);
+  state->cv.wait(lock, [&state]() { return state->done == state->chunks; });
+}
+}  // namespace cryptopals
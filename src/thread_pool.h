@@ -0,0 +1,58 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace cryptopals {
+
+// A fixed set of worker threads.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+  ThreadPool(const ThreadPool &other) = delete;
+  ~ThreadPool();
+
+  // The pool shared by everything in the process.
+  static ThreadPool &global();
+
+  // Number of worker threads.
+  inline size_t size() const { return workers_.size(); }
+
+  // Split [0, n) into chunks of chunk_size and call f(begin, end) once per
+  // chunk, returning when all of them are done. The calling thread works on
+  // chunks too, so this is safe to call from inside a worker.
+  void parallel_for(size_t n, size_t chunk_size,
+                    const std::function<void(size_t, size_t)> &f);
+
+ private:
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void(void)>> tasks_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stop_;
+
+  void submit(std::function<void(void)> task);
+  void work();
+};
+}  // namespace cryptopals
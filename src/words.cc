@@ -17,126 +17,151 @@
 #include "./words.h"
 
 #include <ctype.h>
-#include <cassert>
+#include <algorithm>
 #include <cmath>
-#include <fstream>
-#include <iostream>
-#include <sstream>
-#include <unordered_map>
-#include <unordered_set>
+#include <memory>
 
-namespace cryptopals {
+#include "./dictionary.h"
 
-static std::unordered_set<std::string> words_;
+namespace cryptopals {
 
-inline std::string lowercase(const std::string &input) {
-  std::ostringstream os;
-  for (char c : input) {
-    os << tolower(c);
-  }
-  return os.str();
+// A prebuilt index, from --convert words, and the word list it's compiled
+// from when there isn't one.
+static const char dictionary_index[] = "data/words.idx";
+static const char word_list[] = "/usr/share/dict/words";
+
+const std::array<uint8_t, 256> &char_classes() {
+  static const std::array<uint8_t, 256> classes = [] {
+    std::array<uint8_t, 256> table;
+    for (int b = 0; b < 256; b++) {
+      const char c = static_cast<char>(b);
+      if (!isprint(c) && !isspace(c)) {
+        table[b] = kUnprintable;
+      } else if (isspace(c)) {
+        table[b] = kSpace;
+      } else if (isalpha(c)) {
+        table[b] = tolower(c) - 'a';
+      } else {
+        table[b] = kOtherChar;
+      }
+    }
+    return table;
+  }();
+  return classes;
 }
 
-template <typename T>
-static float distance(const std::unordered_map<T, float> &ref_frequency,
-                      const std::unordered_map<T, size_t> &appearances) {
-  assert(ref_frequency.size() == appearances.size());
-
+// The squared distance between observed and expected frequencies. Entries
+// are always added up in index order (a to z, shortest words first), since
+// float sums depend on the order.
+template <size_t N>
+static float distance(const float (&ref_frequency)[N], const size_t *counts) {
   float count = 0;
-  for (const auto &kv : appearances) {
-    count += kv.second;
+  for (size_t i = 0; i < N; i++) {
+    count += counts[i];
   }
   if (!count) return INFINITY;
 
   float dist = 0;
-  for (const auto &pr : appearances) {
-    float actual_frequency = (float)pr.second / (float)count;
-    const auto it = ref_frequency.find(pr.first);
-    assert(it != ref_frequency.end());
-    float d = actual_frequency - it->second;
+  for (size_t i = 0; i < N; i++) {
+    float actual_frequency = (float)counts[i] / (float)count;
+    float d = actual_frequency - ref_frequency[i];
     dist += d * d;
   }
   return dist;
 }
 
-float score_text(const std::string &text, bool use_dict) {
-  // copied from https://en.wikipedia.org/wiki/Letter_frequency
-  static const std::unordered_map<char, float> char_frequencies{
-      {'a', 8.167e-2},  {'b', 1.492e-2}, {'c', 2.782e-2}, {'d', 4.253e-2},
-      {'e', 12.702e-2}, {'f', 2.228e-2}, {'g', 2.015e-2}, {'h', 6.094e-2},
-      {'i', 6.966e-2},  {'j', 0.153e-2}, {'k', 0.772e-2}, {'l', 4.025e-2},
-      {'m', 2.406e-2},  {'n', 6.749e-2}, {'o', 7.507e-2}, {'p', 1.929e-2},
-      {'q', 0.095e-2},  {'r', 5.987e-2}, {'s', 6.327e-2}, {'t', 9.056e-2},
-      {'u', 2.758e-2},  {'v', 0.978e-2}, {'w', 2.360e-2}, {'x', 0.150e-2},
-      {'y', 1.974e-2},  {'z', 0.074e-2}};
-
-  const size_t length_overflow = 21;
-  static const std::unordered_map<size_t, float> word_lengths{
-      {1, 2.998e-2},  {2, 17.651e-2}, {3, 20.511e-2}, {4, 14.787e-2},
-      {5, 10.700e-2}, {6, 8.388e-2},  {7, 7.939e-2},  {8, 5.943e-2},
-      {9, 4.437e-2},  {10, 3.076e-2}, {11, 1.761e-2}, {12, 0.958e-2},
-      {13, 0.518e-2}, {14, 0.222e-2}, {15, 0.076e-2}, {16, 0.020e-2},
-      {17, 0.010e-2}, {18, 0.004e-2}, {19, 0.001e-2}, {20, 0.001e-2},
-      {21, 0.000e-2}};
-
-  // Build a map of char to count.
-  std::unordered_map<char, size_t> char_counts = {
-      {'a', 0}, {'b', 0}, {'c', 0}, {'d', 0}, {'e', 0}, {'f', 0}, {'g', 0},
-      {'h', 0}, {'i', 0}, {'j', 0}, {'k', 0}, {'l', 0}, {'m', 0}, {'n', 0},
-      {'o', 0}, {'p', 0}, {'q', 0}, {'r', 0}, {'s', 0}, {'t', 0}, {'u', 0},
-      {'v', 0}, {'w', 0}, {'x', 0}, {'y', 0}, {'z', 0}};
-
-  // Map of word frequencies
-  std::unordered_map<size_t, size_t> word_counts = {
-      {1, 0},  {2, 0},  {3, 0},  {4, 0},  {5, 0},  {6, 0},  {7, 0},
-      {8, 0},  {9, 0},  {10, 0}, {11, 0}, {12, 0}, {13, 0}, {14, 0},
-      {15, 0}, {16, 0}, {17, 0}, {18, 0}, {19, 0}, {20, 0}, {21, 0}};
-
-  if (use_dict && words_.empty()) {
-    std::ifstream infile("/usr/share/dict/words");
-    std::string line;
-    while (std::getline(infile, line)) {
-      words_.insert(lowercase(line));
-    }
-  }
+// copied from https://en.wikipedia.org/wiki/Letter_frequency
+static const float letter_frequencies[26] = {
+    8.167e-2, 1.492e-2, 2.782e-2, 4.253e-2, 12.702e-2, 2.228e-2, 2.015e-2,
+    6.094e-2, 6.966e-2, 0.153e-2, 0.772e-2, 4.025e-2,  2.406e-2, 6.749e-2,
+    7.507e-2, 1.929e-2, 0.095e-2, 5.987e-2, 6.327e-2,  9.056e-2, 2.758e-2,
+    0.978e-2, 2.360e-2, 0.150e-2, 1.974e-2, 0.074e-2};
+
+// Word lengths from 1 to 21, where the last entry takes every longer word.
+static const size_t kLengthOverflow = 21;
+static const float word_length_frequencies[kLengthOverflow] = {
+    2.998e-2, 17.651e-2, 20.511e-2, 14.787e-2, 10.700e-2, 8.388e-2, 7.939e-2,
+    5.943e-2, 4.437e-2,  3.076e-2,  1.761e-2,  0.958e-2,  0.518e-2, 0.222e-2,
+    0.076e-2, 0.020e-2,  0.010e-2,  0.004e-2,  0.001e-2,  0.001e-2, 0.000e-2};
+
+float letter_distance(const size_t *counts) {
+  return distance(letter_frequencies, counts);
+}
 
-  float scale = 1;
-  size_t dict_count = 0;
-  std::ostringstream os;
-  for (char c : text) {
-    if (!isprint(c) && !isspace(c)) {
-      scale *= 2;
-      continue;
-    }
+TextScorer::TextScorer() : TextScorer(dictionary_index, word_list) {}
 
-    // check word length
-    if (isspace(c)) {
-      std::string s = os.str();
-      if (s.size()) {
-        std::size_t word_size = std::min(s.size(), length_overflow);
-        word_counts[word_size]++;
-        if (use_dict && words_.find(lowercase(s)) != words_.end()) {
-          dict_count++;
-        }
-        std::ostringstream empty;
-        os.swap(empty);
-      }
-      continue;
-    }
+TextScorer::TextScorer(const std::string &index_path,
+                       const std::string &word_list_path)
+    : index_path_(index_path), word_list_path_(word_list_path) {}
 
-    // skip non-alpha
-    if (!isalpha(c)) continue;
+TextScorer::~TextScorer() {}
 
-    // convert to downcase
-    if (isupper(c)) {
-      c = tolower(c);
+const TextScorer &TextScorer::global() {
+  static const TextScorer scorer;
+  return scorer;
+}
+
+// Without an index or a word list the dictionary is empty, and then score()
+// works as if use_dict were false. Its pages are all faulted in as it's
+// loaded, so that the lookups of whichever search loaded it don't take turns
+// doing that.
+const Dictionary &TextScorer::dictionary() const {
+  std::call_once(loaded_, [this] {
+    auto index = std::make_unique<Dictionary>(index_path_);
+    dictionary_ =
+        index->valid() ? std::move(index) : Dictionary::build(word_list_path_);
+    dictionary_->prefault();
+  });
+  return *dictionary_;
+}
+
+void TextScorer::warmup() const {
+  char_classes();
+  dictionary();
+}
+
+float TextScorer::score(std::string_view text, bool use_dict) const {
+  const std::array<uint8_t, 256> &classes = char_classes();
+  const Dictionary *words = nullptr;
+  if (use_dict && dictionary().size()) words = &dictionary();
+
+  // Counts per class, so the letters come first, then per word length.
+  size_t char_counts[kOtherChar + 1] = {};
+  size_t word_counts[kLengthOverflow] = {};
+
+  // A word is hashed as it's scanned, so the dictionary only goes back to
+  // its letters in text if the Bloom filter passes it.
+  size_t word_start = 0, word_size = 0;
+  uint64_t word_hash = 0;
+  size_t dict_count = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    const int cls = classes[static_cast<uint8_t>(text[i])];
+    char_counts[cls]++;
+    if (cls < 26) {
+      if (words != nullptr) {
+        if (!word_size) {
+          word_start = i;
+          word_hash = words->hash_start();
+        }
+        word_hash = Dictionary::hash_step(word_hash, 'a' + cls);
+      }
+      word_size++;
+    } else if (cls == kSpace && word_size) {
+      word_counts[std::min(word_size, kLengthOverflow) - 1]++;
+      if (words != nullptr &&
+          words->contains(word_hash, text.substr(word_start, i - word_start))) {
+        dict_count++;
+      }
+      word_size = 0;
     }
-    char_counts[c]++;
-    os << c;
   }
 
-  const float char_dist = distance(char_frequencies, char_counts);
-  const float word_dist = distance(word_lengths, word_counts);
+  const float char_dist = distance(letter_frequencies, char_counts);
+  const float word_dist = distance(word_length_frequencies, word_counts);
+  // Each unprintable character doubles the score; past 127 it's infinite.
+  const float scale =
+      std::ldexp(1.0f, static_cast<int>(
+                           std::min<size_t>(char_counts[kUnprintable], 256)));
   float rt = char_dist * word_dist * scale;
   if (use_dict && dict_count) {
     rt /= dict_count;
@@ -144,4 +169,8 @@ float score_text(const std::string &text, bool use_dict) {
   return rt;
 }
 
+float score_text(std::string_view text, bool use_dict) {
+  return TextScorer::global().score(text, use_dict);
+}
+
 }  // namespace cryptopals
@@ -16,8 +16,67 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 
 namespace cryptopals {
-float score_text(const std::string &text, bool use_dict = true);
+class Dictionary;
+
+// Scores text by how much it looks like English: letter frequencies, word
+// lengths, and how many of its words are in a dictionary. The dictionary is
+// the only part that isn't fixed, and it's loaded once, by warmup() or by the
+// first score() that needs it. After that nothing changes, so any number of
+// threads can score with one scorer.
+class TextScorer {
+ public:
+  // The dictionary is the index at data/words.idx (see --convert words), or
+  // is compiled from /usr/share/dict/words if there isn't one.
+  TextScorer();
+  TextScorer(const std::string &index_path, const std::string &word_list_path);
+  TextScorer(const TextScorer &other) = delete;
+  ~TextScorer();
+
+  // The scorer used by score_text().
+  static const TextScorer &global();
+
+  // Load the dictionary and fault in its pages now, e.g. before timing a
+  // search, instead of on the first score() that uses it.
+  void warmup() const;
+
+  // Lower scores look more like English. Counting is done in fixed arrays
+  // and words are looked up from a hash of their letters, so this doesn't
+  // allocate.
+  float score(std::string_view text, bool use_dict = true) const;
+
+ private:
+  const Dictionary &dictionary() const;
+
+  const std::string index_path_;
+  const std::string word_list_path_;
+  mutable std::once_flag loaded_;
+  mutable std::unique_ptr<Dictionary> dictionary_;
+};
+
+// TextScorer::global().score()
+float score_text(std::string_view text, bool use_dict = true);
+
+// The letter frequency part of score_text(), from the counts of 'a' through
+// 'z' with case folded. It's the same number score_text() uses, for ranking
+// candidates cheaply.
+float letter_distance(const size_t *counts);
+
+// What score_text() sees in each byte: a letter (its index, case folded),
+// a character that doubles the score, whitespace, which ends words, or
+// anything else.
+constexpr int kUnprintable = 26;
+constexpr int kSpace = 27;
+constexpr int kOtherChar = 28;
+
+// The class of every byte, indexed by its unsigned value.
+const std::array<uint8_t, 256> &char_classes();
 }
@@ -0,0 +1,282 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "xor.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+// Carry on from position phase of the key, without a modulo per byte.
+static void repeating_scalar(const uint8_t* in, size_t len, const uint8_t* key,
+                             size_t key_len, size_t phase, uint8_t* out) {
+  for (size_t i = 0; i < len; i++) {
+    out[i] = in[i] ^ key[phase];
+    if (++phase == key_len) {
+      phase = 0;
+    }
+  }
+}
+
+static size_t buffers_scalar(const uint8_t* a, const uint8_t* b, size_t len,
+                             uint8_t* out) {
+  for (size_t i = 0; i < len; i++) {
+    out[i] = a[i] ^ b[i];
+  }
+  return len;
+}
+
+static size_t hamming_scalar(const uint8_t* a, const uint8_t* b, size_t len) {
+  size_t bits = 0, i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    bits += __builtin_popcountll(x ^ y);
+  }
+  for (; i < len; i++) {
+    bits += __builtin_popcount(a[i] ^ b[i]);
+  }
+  return bits;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define POPCNT_TARGET __attribute__((target("popcnt")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+// The same code as hamming_scalar(), but __builtin_popcountll() becomes one
+// instruction instead of a bit twiddling sequence.
+POPCNT_TARGET static size_t hamming_popcnt(const uint8_t* a, const uint8_t* b,
+                                           size_t len) {
+  size_t bits = 0, i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    bits += __builtin_popcountll(x ^ y);
+  }
+  for (; i < len; i++) {
+    bits += __builtin_popcount(a[i] ^ b[i]);
+  }
+  return bits;
+}
+
+// Count the bits of each nibble with a pshufb lookup, and sum the bytes
+// into 64-bit lanes with psadbw.
+AVX2_TARGET static size_t hamming_avx2(const uint8_t* a, const uint8_t* b,
+                                       size_t len) {
+  const __m256i counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3,
+                                          2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3,
+                                          1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  __m256i total = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    const __m256i x =
+        _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                         _mm256_loadu_si256((const __m256i*)(b + i)));
+    const __m256i lo = _mm256_shuffle_epi8(counts, _mm256_and_si256(x, nibble));
+    const __m256i hi = _mm256_shuffle_epi8(
+        counts, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+    total = _mm256_add_epi64(
+        total,
+        _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, total);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         hamming_scalar(a + i, b + i, len - i);
+}
+
+// The repeating kernels read the key from a pattern holding it repeated
+// over period + one vector of bytes, where period is a multiple of the key
+// length at least a vector wide. Each step loads a vector at the current
+// phase and advances it by a vector, wrapping once it passes period, so
+// the key lines up with every position. They return how many bytes they
+// did, always a whole number of vectors.
+
+AVX2_TARGET static size_t repeating_avx2(const uint8_t* in, size_t len,
+                                         const uint8_t* pattern,
+                                         size_t period, uint8_t* out) {
+  size_t i = 0, phase = 0;
+  for (; i + 32 <= len; i += 32) {
+    const __m256i k = _mm256_loadu_si256((const __m256i*)(pattern + phase));
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(v, k));
+    phase += 32;
+    if (phase >= period) {
+      phase -= period;
+    }
+  }
+  return i;
+}
+
+AVX2_TARGET static size_t buffers_avx2(const uint8_t* a, const uint8_t* b,
+                                       size_t len, uint8_t* out) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    const __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+    const __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(x, y));
+  }
+  return i;
+}
+
+AVX512_TARGET static size_t repeating_avx512(const uint8_t* in, size_t len,
+                                             const uint8_t* pattern,
+                                             size_t period, uint8_t* out) {
+  size_t i = 0, phase = 0;
+  for (; i + 64 <= len; i += 64) {
+    const __m512i k = _mm512_loadu_si512(pattern + phase);
+    const __m512i v = _mm512_loadu_si512(in + i);
+    _mm512_storeu_si512(out + i, _mm512_xor_si512(v, k));
+    phase += 64;
+    if (phase >= period) {
+      phase -= period;
+    }
+  }
+  return i;
+}
+
+AVX512_TARGET static size_t buffers_avx512(const uint8_t* a, const uint8_t* b,
+                                           size_t len, uint8_t* out) {
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    const __m512i x = _mm512_loadu_si512(a + i);
+    const __m512i y = _mm512_loadu_si512(b + i);
+    _mm512_storeu_si512(out + i, _mm512_xor_si512(x, y));
+  }
+  return i;
+}
+
+#endif
+
+static const unsigned impl_features[] = {0, CPU_AVX2, CPU_AVX512F};
+
+// The repeating kernel works in vectors of width bytes, and there's none for
+// scalar code. The buffers kernel returns how many bytes it did.
+static enum XOR_impl impl;
+static size_t width;
+static size_t (*repeating)(const uint8_t* in, size_t len,
+                           const uint8_t* pattern, size_t period,
+                           uint8_t* out);
+static size_t (*buffers)(const uint8_t* a, const uint8_t* b, size_t len,
+                         uint8_t* out);
+static size_t (*hamming)(const uint8_t* a, const uint8_t* b, size_t len);
+
+static void use_impl(enum XOR_impl i) {
+  impl = i;
+  switch (i) {
+#if defined(__x86_64__) || defined(__i386__)
+    case XOR_IMPL_AVX512:
+      width = 64;
+      repeating = repeating_avx512;
+      buffers = buffers_avx512;
+      break;
+    case XOR_IMPL_AVX2:
+      width = 32;
+      repeating = repeating_avx2;
+      buffers = buffers_avx2;
+      break;
+#endif
+    default:
+      width = 0;
+      repeating = NULL;
+      buffers = buffers_scalar;
+      break;
+  }
+}
+
+static void bind(void) {
+  enum XOR_impl best = XOR_IMPL_SCALAR;
+  if (CPU_has(CPU_AVX512F)) {
+    best = XOR_IMPL_AVX512;
+  } else if (CPU_has(CPU_AVX2)) {
+    best = XOR_IMPL_AVX2;
+  }
+  use_impl(best);
+
+  hamming = hamming_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+  if (CPU_has(CPU_AVX2)) {
+    hamming = hamming_avx2;
+  } else if (CPU_has(CPU_POPCNT)) {
+    hamming = hamming_popcnt;
+  }
+#endif
+}
+
+__attribute__((constructor)) static void Init(void) {
+  CPU_register(bind);
+}
+
+enum XOR_impl XOR_get_impl(void) {
+  return impl;
+}
+
+int XOR_set_impl(enum XOR_impl i) {
+  if (!CPU_has(impl_features[i])) {
+    return 0;
+  }
+  use_impl(i);
+  return 1;
+}
+
+// patterns for keys up to about this size live on the stack
+#define PATTERN_STACK_SIZE 1024
+
+void XOR_repeating(const uint8_t* in, size_t len, const uint8_t* key,
+                   size_t key_len, uint8_t* out) {
+  assert(key_len > 0);
+  size_t done = 0;
+  if (width && len >= width) {
+    const size_t period = (width + key_len - 1) / key_len * key_len;
+    uint8_t stack_pattern[PATTERN_STACK_SIZE];
+    uint8_t* pattern = period + width <= sizeof(stack_pattern)
+                           ? stack_pattern
+                           : (uint8_t*)malloc(period + width);
+    assert(pattern != NULL);
+    for (size_t i = 0, j = 0; i < period + width; i++) {
+      pattern[i] = key[j];
+      if (++j == key_len) {
+        j = 0;
+      }
+    }
+    done = repeating(in, len, pattern, period, out);
+    if (pattern != stack_pattern) {
+      free(pattern);
+    }
+  }
+  repeating_scalar(in + done, len - done, key, key_len, done % key_len,
+                   out + done);
+}
+
+void XOR_buffers(const uint8_t* a, const uint8_t* b, size_t len,
+                 uint8_t* out) {
+  const size_t done = buffers(a, b, len, out);
+  buffers_scalar(a + done, b + done, len - done, out + done);
+}
+
+size_t XOR_hamming(const uint8_t* a, const uint8_t* b, size_t len) {
+  return hamming(a, b, len);
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2018 Evan Klitzke <evan@eklitzke.org>
+//
+// This file is part of cryptopals.
+//
+// cryptopals is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// cryptopals is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// cryptopals. If not, see <http://www.gnu.org/licenses/>.
+
+
+// XOR kernels for whole buffers: against a repeating key (a single byte being
+// a key of length 1) and against another buffer. The output may be the input,
+// so the same calls work in place and as a fused XOR-and-copy. AVX-512 or
+// AVX2 versions are used when the CPU has them.
+
+#ifndef _XOR_H_
+#define _XOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum XOR_impl {
+  XOR_IMPL_SCALAR = 0,
+  XOR_IMPL_AVX2 = 1,
+  XOR_IMPL_AVX512 = 2,
+};
+
+// The best implementation the CPU tier allows is picked at startup, and
+// again whenever the tier changes (see cpu.h).
+enum XOR_impl XOR_get_impl(void);
+
+// Force a particular implementation, e.g. to test them against each other.
+// Returns 0 (and changes nothing) if the CPU tier doesn't allow it.
+int XOR_set_impl(enum XOR_impl impl);
+
+// out[i] = in[i] ^ key[i % key_len] for i < len. key_len must be nonzero.
+void XOR_repeating(const uint8_t* in, size_t len, const uint8_t* key,
+                   size_t key_len, uint8_t* out);
+
+// out[i] = a[i] ^ b[i] for i < len.
+void XOR_buffers(const uint8_t* a, const uint8_t* b, size_t len,
+                 uint8_t* out);
+
+// The number of bits that differ between a and b. This uses its own kernels
+// (POPCNT or AVX2), chosen by the CPU tier rather than XOR_set_impl().
+size_t XOR_hamming(const uint8_t* a, const uint8_t* b, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_XOR_H_